@@ -1,4 +1,6 @@
 #include "cemuhookserver.h"
+#include "crc32.h"
+#include "logger.h"
 
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_gamecontroller.h>
@@ -6,59 +8,53 @@
 #include <chrono>
 #include <cstddef>
 #include <cstdint>
-#include <iostream>
-#include <sstream>
 #include <sys/types.h>
 #include <vector>
 
-using std::cout;
 using namespace std::chrono;
 
 #define BUFLEN 50
 #define SERVER_ID 69
 #define MAIN_SLEEP_TIME_MS 500
-#define THREAD_SLEEP_TIME_MS 5
 #define CLIENT_TIMEOUT 40 // 20 Seconds ((MAIN_SLEEP_TIME_MS + socketTimeout) * CLIENT_TIMEOUT / 1000)
-
-#define VERSION_TYPE 0x100000
-#define INFO_TYPE 0x100001
-#define DATA_TYPE 0x100002
+#define LATENCY_REPORT_INTERVAL 20 // 10 Seconds (MAIN_SLEEP_TIME_MS * LATENCY_REPORT_INTERVAL / 1000)
 
 namespace {
 
-uint32_t crc32(const unsigned char *s, size_t n) {
-    uint32_t crc = 0xFFFFFFFF;
-
-    int k;
-
-    while (n--) {
-        crc ^= *s++;
-        for (k = 0; k < 8; k++)
-            crc = crc & 1 ? (crc >> 1) ^ 0xedb88320 : crc >> 1;
-    }
-    return ~crc;
-}
-
-bool motion_is_zero(DataEvent &dataAnswer) {
-    return dataAnswer.motion.accX == 0.0F &&
-           dataAnswer.motion.accY == 0.0F &&
-           dataAnswer.motion.accZ == 0.0F &&
-           dataAnswer.motion.pitch == 0.0F &&
-           dataAnswer.motion.yaw == 0.0F &&
-           dataAnswer.motion.roll == 0.0F;
+bool motion_is_zero(MotionVector const &motion) {
+    return std::all_of(motion.begin(), motion.end(), [](float value) { return value == 0.0F; });
 }
 
 } // namespace
 
 Server::Server(const Config *cfg, Gamepad *g)
     : serverPort(cfg->port),
+      sendIntervalUs(cfg->send_interval_us),
       gyro_compensation(cfg->gyro_compensation),
-      gamepad(g) {
+      latency_trace(cfg->latency_trace),
+      sample_timestamps(cfg->sample_timestamps),
+      multicast(cfg->multicast_enabled),
+      multicastTtl(cfg->multicast_ttl),
+      multicastLoop(cfg->multicast_loop),
+      shm_enabled(cfg->shm_enabled),
+      shmName(cfg->shm_name),
+      shmSlots(cfg->shm_slots),
+      gamepad(g),
+      clients(cfg->max_clients),
+      mixer(cfg->acc_limit, cfg->gyro_limit) {
+    if (gyro_compensation)
+        gyro_tracker.history.resize(std::max<uint64_t>(GYRO_HISTORY_MS * 1000ULL / std::max<uint32_t>(sendIntervalUs, 1), 1));
     PrepareAnswerConstants();
+    PrepareMotionSources(cfg);
+    if (multicast)
+        PrepareMulticast(cfg);
 }
 
 void Server::Start() {
     stopFlag = false;
+    if (shm_enabled) {
+        shm.Open(shmName, shmSlots);
+    }
     runThread.reset(new std::thread(&Server::run, this));
     sendThread.reset(new std::thread(&Server::sendTask, this));
 }
@@ -71,21 +67,36 @@ void Server::Stop() {
     if (runThread.get() != nullptr) {
         runThread->join();
     }
+    shm.Close();
+    if (latency_trace) {
+        tracer.Report();
+    }
+    if (parser.RejectedTotal() > 0) {
+        LOG_INFO("Server: Rejected {} malformed packets.", parser.RejectedTotal());
+        for (int i = PARSE_OK + 1; i < PARSE_RESULTS; i++) {
+            if (parser.Rejected(static_cast<ParseResult>(i)) > 0)
+                LOG_INFO("  {}: {}", RequestParser::Describe(static_cast<ParseResult>(i)), parser.Rejected(static_cast<ParseResult>(i)));
+        }
+    }
 }
 
 void Server::PrepareAnswerConstants() {
-    cout << "Server: Pre-filling messages.\n";
+    LOG_INFO("Server: Pre-filling messages.");
     Header outHeader;
     outHeader.magic[0] = 'D';
     outHeader.magic[1] = 'S';
     outHeader.magic[2] = 'U';
     outHeader.magic[3] = 'S';
-    outHeader.version = 1001;
+    outHeader.version = PROTOCOL_VERSION;
     outHeader.id = SERVER_ID;
 
     versionAnswer.header = outHeader;
+    versionAnswer.header.eventType = VERSION_TYPE;
     versionAnswer.header.length = sizeof(versionAnswer.version) + 4;
-    versionAnswer.version = 1001;
+    versionAnswer.version = PROTOCOL_VERSION;
+    // Never changes, so the CRC is computed once
+    versionAnswer.header.crc32 = 0;
+    versionAnswer.header.crc32 = crc32(reinterpret_cast<unsigned char *>(&versionAnswer), sizeof(versionAnswer));
 
     sharedResponse.slot = 0;
     sharedResponse.slotState = 2;
@@ -132,8 +143,46 @@ void Server::PrepareAnswerConstants() {
     dataAnswer.motion.roll = 0;
 }
 
+void Server::PrepareMotionSources(const Config *cfg) {
+    autoShakeSource = mixer.AddSource(cfg->auto_shake_blend);
+    compensationSource = mixer.AddSource(cfg->compensation_blend, false);
+
+    // Buttons take consecutive sources, so button i is always firstButtonSource + i
+    std::vector<ConfiguredButton> &configButtons = gamepad->GetButtonStates();
+    firstButtonSource = mixer.AddSource(cfg->buttons_blend);
+    for (size_t i = 1; i < configButtons.size(); i++) {
+        mixer.AddSource(cfg->buttons_blend);
+    }
+
+    // Response curves are compiled into lookup tables here, once
+    for (ConfiguredAxis const &axis : cfg->axes) {
+        analogMappings.push_back({axis.axis, axis.target, mixer.AddSource(cfg->analog_blend, false),
+                                  ResponseCurve(axis.deadzone, axis.exponent, axis.scale)});
+    }
+}
+
+void Server::PrepareMulticast(const Config *cfg) {
+    uint32_t port = cfg->multicast_port != 0 ? cfg->multicast_port : cfg->port + 1;
+    if (port > UINT16_MAX)
+        throw std::runtime_error("Server: Invalid multicast port " + std::to_string(port) + ".");
+
+    if (multicastTtl < 0 || multicastTtl > 255)
+        throw std::runtime_error("Server: Invalid multicast ttl " + std::to_string(multicastTtl) + ".");
+
+    multicastAddr = sockaddr_in();
+    multicastAddr.sin_family = AF_INET;
+    multicastAddr.sin_port = htons(port);
+
+    if (inet_pton(AF_INET, cfg->multicast_group.c_str(), &multicastAddr.sin_addr) != 1 ||
+        (ntohl(multicastAddr.sin_addr.s_addr) >> 28) != 0xE) // 224.0.0.0/4
+        throw std::runtime_error("Server: Invalid multicast group " + cfg->multicast_group + ".");
+
+    if (inet_pton(AF_INET, cfg->multicast_interface.c_str(), &multicastInterface) != 1)
+        throw std::runtime_error("Server: Invalid multicast interface " + cfg->multicast_interface + ".");
+}
+
 void Server::run() {
-    cout << "Server: Initializing.\n";
+    LOG_INFO("Server: Initializing.");
 
     crossSockets::initializeSockets();
 
@@ -162,76 +211,113 @@ void Server::run() {
     if (bind(socketFd, (sockaddr *)&sockAddr, sizeof(sockAddr)) < 0)
         throw std::runtime_error("Server: Bind failed.");
 
-    char ipStr[INET6_ADDRSTRLEN];
-    ipStr[0] = 0;
-    cout << "Server: Socket created at IP: " << crossSockets::GetIP(sockAddr, ipStr) << " Port: " << ntohs(sockAddr.sin_port) << ".\n";
+    LOG_INFO("Server: Socket created at IP: {} Port: {}.", logger::Ipv4{sockAddr.sin_addr.s_addr}, ntohs(sockAddr.sin_port));
+
+    if (multicast && crossSockets::setMulticastOptions(socketFd, multicastTtl, multicastInterface, multicastLoop)) {
+        LOG_INFO("Server: Sending data to multicast group IP: {} Port: {}.", logger::Ipv4{multicastAddr.sin_addr.s_addr}, ntohs(multicastAddr.sin_port));
+    }
 
-    char buf[BUFLEN];
+    unsigned char buf[BUFLEN];
     sockaddr_in sockInClient;
     socklen_t sockInClientLen = sizeof(sockInClient);
-    ssize_t headerSize = (ssize_t)sizeof(Header);
-    std::pair<uint16_t, void const *> outBuf;
+    RequestView request;
 
-    cout << "Server: Start listening for client.\n";
+    LOG_INFO("Server: Start listening for client.");
 
+    int reportCnt = 0;
     while (!stopFlag) {
-        auto recvLen = recvfrom(socketFd, buf, BUFLEN, 0, (sockaddr *)&sockInClient, &sockInClientLen);
-        if (recvLen >= headerSize) {
-            Header &header = *reinterpret_cast<Header *>(buf);
-
-            std::ostringstream addressTextStream;
-            addressTextStream << "IP: " << crossSockets::GetIP(sockInClient, ipStr) << " Port: " << ntohs(sockInClient.sin_port);
-            auto addressText = addressTextStream.str();
-
-            switch (header.eventType) {
-            case VERSION_TYPE:
-                // cout << "Server: A client asked for version. " << addressText << ".\n";
-                break;
-            case INFO_TYPE: {
-                // cout << "Server: A client asked for controller info. " << addressText << ".\n";
-                InfoRequest &req = *reinterpret_cast<InfoRequest *>(buf + headerSize);
-                for (int i = 0; i < req.portCnt; i++) {
-                    outBuf = PrepareInfoAnswer(req.slots[i]);
-                    crossSockets::SendPacket(socketFd, outBuf, sockInClient);
-                }
-            } break;
-            case DATA_TYPE:
-                auto client = std::find(clients.begin(), clients.end(), sockInClient);
-                if (client == clients.end()) {
-                    // cout << "Server: Request for data from new client. " << addressText << ".\n";
-
-                    Client &newClient = clients.emplace_back();
-                    newClient.address = sockInClient;
-                    newClient.id = header.id;
-                    newClient.sendTimeout = 0;
-
-                    cout << "Server: New client subscribed. " << addressText << ".\n";
-                } else {
-                    // cout << "Server: Request for data from existing client. " << addressText << ".\n";
-                    client->sendTimeout = 0;
-                }
-                break;
+        auto recvLen = recvfrom(socketFd, (char *)buf, BUFLEN, 0, (sockaddr *)&sockInClient, &sockInClientLen);
+        if (recvLen > 0) {
+            ParseResult parsed = parser.Parse(buf, recvLen, request);
+            if (parsed != PARSE_OK) {
+                LOG_DEBUG("Server: Rejected packet ({}). IP: {} Port: {}.", RequestParser::Describe(parsed), logger::Ipv4{sockInClient.sin_addr.s_addr}, ntohs(sockInClient.sin_port));
+            } else {
+                handleRequest(request, sockInClient);
             }
         }
 
         handleClientsTimeout();
 
+        if (latency_trace && ++reportCnt >= LATENCY_REPORT_INTERVAL) {
+            tracer.Report();
+            reportCnt = 0;
+        }
+
         std::this_thread::sleep_for(milliseconds(MAIN_SLEEP_TIME_MS));
     }
 }
 
-void Server::handleClientsTimeout() {
-    for (auto it = clients.begin(); it != clients.end();) {
-        it->sendTimeout++;
-        if (it->sendTimeout >= CLIENT_TIMEOUT) {
-            it = clients.erase(it);
-            cout << "Client timed out\n";
+void Server::handleRequest(RequestView const &request, sockaddr_in const &sockInClient) {
+    std::pair<uint16_t, void const *> outBuf;
+
+    switch (request.header->eventType) {
+    case VERSION_TYPE:
+        LOG_DEBUG("Server: A client asked for version. IP: {} Port: {}.", logger::Ipv4{sockInClient.sin_addr.s_addr}, ntohs(sockInClient.sin_port));
+        outBuf = std::pair<uint16_t, void const *>(sizeof(versionAnswer), reinterpret_cast<void const *>(&versionAnswer));
+        crossSockets::SendPacket(socketFd, outBuf, sockInClient);
+        break;
+    case INFO_TYPE: {
+        LOG_DEBUG("Server: A client asked for controller info. IP: {} Port: {}.", logger::Ipv4{sockInClient.sin_addr.s_addr}, ntohs(sockInClient.sin_port));
+        InfoRequest const &req = request.info();
+        for (int i = 0; i < req.portCnt; i++) {
+            outBuf = PrepareInfoAnswer(req.slots[i]);
+            crossSockets::SendPacket(socketFd, outBuf, sockInClient);
+        }
+    } break;
+    case DATA_TYPE:
+        Client *client = findClient(&sockInClient);
+        if (client == nullptr) {
+            Client *newClient = findClient(nullptr);
+            if (newClient == nullptr) {
+                LOG_WARN("Server: Too many clients (max_clients), ignoring IP: {} Port: {}.", logger::Ipv4{sockInClient.sin_addr.s_addr}, ntohs(sockInClient.sin_port));
+                break;
+            }
+
+            newClient->address = sockInClient;
+            newClient->id = request.header->id;
+            newClient->sendTimeout = 0;
+            newClient->active.store(true, std::memory_order_release);
+
+            LOG_INFO("Server: New client subscribed. IP: {} Port: {}.", logger::Ipv4{sockInClient.sin_addr.s_addr}, ntohs(sockInClient.sin_port));
         } else {
-            ++it;
+            LOG_DEBUG("Server: Request for data from existing client. IP: {} Port: {}.", logger::Ipv4{sockInClient.sin_addr.s_addr}, ntohs(sockInClient.sin_port));
+            client->sendTimeout = 0;
+        }
+        break;
+    }
+}
+
+void Server::handleClientsTimeout() {
+    for (auto &client : clients) {
+        if (!client.active.load(std::memory_order_relaxed))
+            continue;
+
+        client.sendTimeout++;
+        if (client.sendTimeout >= CLIENT_TIMEOUT) {
+            client.active.store(false, std::memory_order_release);
+            LOG_INFO("Client timed out");
         }
     }
 }
 
+bool Server::hasClients() {
+    for (auto &client : clients) {
+        if (client.active.load(std::memory_order_relaxed))
+            return true;
+    }
+    return false;
+}
+
+// Returns the active client with that address, or a free entry if address is nullptr
+Server::Client *Server::findClient(sockaddr_in const *address) {
+    for (auto &client : clients) {
+        bool active = client.active.load(std::memory_order_relaxed);
+        if (address == nullptr ? !active : active && client == *address)
+            return &client;
+    }
+    return nullptr;
+}
+
 std::pair<uint16_t, void const *> Server::PrepareInfoAnswer(uint8_t const &slot) {
     static const uint16_t len = sizeof(infoNoneAnswer);
 
@@ -250,13 +336,42 @@ std::pair<uint16_t, void const *> Server::PrepareInfoAnswer(uint8_t const &slot)
 void Server::sendTask() {
     std::pair<uint16_t, void const *> outBuf;
     uint32_t packet = 0;
+    steady_clock::time_point nextSend = steady_clock::now();
 
     while (!stopFlag) {
         outBuf = PrepareDataAnswer(++packet);
-        for (auto &client : clients) {
-            crossSockets::SendPacket(socketFd, outBuf, client.address);
+        shm.Publish(dataAnswer);
+
+        bool sent = false;
+        if (multicast) {
+            // One copy for every subscriber, clients still subscribe and time out as usual
+            if (hasClients()) {
+                crossSockets::SendPacket(socketFd, outBuf, multicastAddr);
+                sent = true;
+            }
+        } else {
+            for (auto &client : clients) {
+                if (!client.active.load(std::memory_order_acquire))
+                    continue;
+                crossSockets::SendPacket(socketFd, outBuf, client.address);
+                sent = true;
+            }
         }
-        std::this_thread::sleep_for(milliseconds(THREAD_SLEEP_TIME_MS));
+
+        // Every stage is recorded together once per tick, only for packets that reached a socket,
+        // so all histograms count the same ticks. Send is when the last copy left.
+        if (sent && latency_trace && tickSampleTime != 0) {
+            stageTimes[STAGE_SEND] = MonotonicMicros();
+            for (int stage = 0; stage < LATENCY_STAGES; stage++)
+                tracer.Record(static_cast<LatencyStage>(stage), tickSampleTime, stageTimes[stage]);
+        }
+
+        // Absolute deadlines keep the send rate steady regardless of how long the tick took
+        nextSend += microseconds(sendIntervalUs);
+        steady_clock::time_point now = steady_clock::now();
+        if (nextSend < now)
+            nextSend = now;
+        std::this_thread::sleep_until(nextSend);
     }
 }
 
@@ -264,23 +379,13 @@ std::pair<uint16_t, void const *> Server::PrepareDataAnswer(uint32_t const &pack
     static const uint16_t len = sizeof(dataAnswer);
     dataAnswer.packetNumber = packet;
 
-    high_resolution_clock::duration tp = high_resolution_clock::now().time_since_epoch();
-    microseconds us = duration_cast<microseconds>(tp);
-
-    dataAnswer.motion.timestamp = us.count();
-
-    dataAnswer.motion.accX = 0;
-    dataAnswer.motion.accY = 0;
-    dataAnswer.motion.accZ = 0;
-
-    dataAnswer.motion.pitch = 0;
-    dataAnswer.motion.yaw = 0;
-    dataAnswer.motion.roll = 0;
+    mixer.Clear();
+    tickSampleTime = 0;
 
     static uint16_t automatic_cnt = 0;
     if (gamepad->IsAutomaticShakeActive()) {
         if (automatic_cnt % 2 == 0) {
-            dataAnswer.motion.accX = 500;
+            mixer.Set(autoShakeSource, 500, 0, 0, 0, 0, 0);
         }
 
         automatic_cnt++;
@@ -291,22 +396,66 @@ std::pair<uint16_t, void const *> Server::PrepareDataAnswer(uint32_t const &pack
     std::vector<ConfiguredButton> &configButtons = gamepad->GetButtonStates();
 
     for (size_t i = 0; i < configButtons.size(); i++) {
-        if (configButtons[i].pending) {
-            dataAnswer.motion.accX = configButtons[i].accX;
-            dataAnswer.motion.accY = configButtons[i].accY;
-            dataAnswer.motion.accZ = configButtons[i].accZ;
-            dataAnswer.motion.pitch = configButtons[i].pitch;
-            dataAnswer.motion.yaw = configButtons[i].yaw;
-            dataAnswer.motion.roll = configButtons[i].roll;
-            configButtons[i].pending = false;
+        uint64_t pendingSince = configButtons[i].pendingSince.exchange(0, std::memory_order_acquire);
+        if (pendingSince != 0) {
+            ConfiguredButton const &btn = configButtons[i];
+            mixer.Set(firstButtonSource + i, btn.accX, btn.accY, btn.accZ, btn.pitch, btn.yaw, btn.roll);
+            if (tickSampleTime == 0 || pendingSince < tickSampleTime)
+                tickSampleTime = pendingSince;
         }
     }
 
-    if (gyro_compensation)
-        proccess_gyro_compensation();
+    for (AnalogMapping const &mapping : analogMappings) {
+        float value = mapping.curve.Evaluate(gamepad->GetAxis(mapping.axis));
+        if (value != 0.0F) {
+            MotionVector motion = {};
+            motion[mapping.target] = value;
+            mixer.Set(mapping.source, motion);
+            if (tickSampleTime == 0)
+                tickSampleTime = gamepad->LastSampleTime();
+        }
+    }
+
+    if (latency_trace)
+        stageTimes[STAGE_HANDOFF] = MonotonicMicros();
+
+    bool compensating = gyro_compensation && queue_gyro_compensation();
+
+    MotionVector motion = mixer.Compose();
+    dataAnswer.motion.accX = motion[AXIS_ACC_X];
+    dataAnswer.motion.accY = motion[AXIS_ACC_Y];
+    dataAnswer.motion.accZ = motion[AXIS_ACC_Z];
+    dataAnswer.motion.pitch = motion[AXIS_PITCH];
+    dataAnswer.motion.yaw = motion[AXIS_YAW];
+    dataAnswer.motion.roll = motion[AXIS_ROLL];
+
+    // Analog aiming is left out, only the motion of buttons and auto shake is undone
+    if (gyro_compensation && !compensating)
+        record_gyro_compensation(mixer.ComposeCompensated());
+
+    if (sample_timestamps) {
+        uint64_t stamp = tickSampleTime != 0 ? tickSampleTime : gamepad->LastSampleTime();
+        // No new poll since the last packet (or an older held press): clients derive dt from
+        // consecutive stamps, so never repeat or go back, fall back to the send time instead
+        if (stamp <= lastTimestamp)
+            stamp = std::max(MonotonicMicros(), lastTimestamp + 1);
+        lastTimestamp = stamp;
+        dataAnswer.motion.timestamp = stamp;
+    } else {
+        high_resolution_clock::duration tp = high_resolution_clock::now().time_since_epoch();
+        microseconds us = duration_cast<microseconds>(tp);
+
+        dataAnswer.motion.timestamp = us.count();
+    }
+
+    if (latency_trace)
+        stageTimes[STAGE_BUILD] = MonotonicMicros();
 
     CalcCrcDataAnswer();
 
+    if (latency_trace)
+        stageTimes[STAGE_CRC] = MonotonicMicros();
+
     return std::pair<uint16_t, void const *>(len, reinterpret_cast<void *>(&dataAnswer));
 }
 
@@ -317,15 +466,27 @@ void Server::CalcCrcDataAnswer() {
     dataAnswer.header.crc32 = crc32(reinterpret_cast<unsigned char *>(&dataAnswer), len);
 }
 
-void Server::proccess_gyro_compensation() {
-    if (!motion_is_zero(dataAnswer)) {
-        gyro_tracker.history.push_back({dataAnswer.motion.pitch, dataAnswer.motion.yaw, dataAnswer.motion.roll});
-    } else if (!gyro_tracker.history.empty()) {
-        auto const &sample = gyro_tracker.history.back();
-        dataAnswer.motion.pitch = -sample[0];
-        dataAnswer.motion.yaw = -sample[1];
-        dataAnswer.motion.roll = -sample[2];
-        gyro_tracker.history.pop_back();
+// Compensation only kicks in once every compensated source is idle, replaying the recorded motion in reverse.
+// Analog sources can stay active meanwhile, their motion is blended on top.
+// Returns true if a compensation sample was queued for this tick.
+bool Server::queue_gyro_compensation() {
+    if (mixer.AnyCompensatedActive() || gyro_tracker.empty())
+        return false;
+
+    auto const &sample = gyro_tracker.back();
+    mixer.Set(compensationSource, 0, 0, 0, -sample[0], -sample[1], -sample[2]);
+    gyro_tracker.pop_back();
+    if (gyro_tracker.empty())
+        gyroHistoryOverflowed = false;
+    return true;
+}
+
+void Server::record_gyro_compensation(MotionVector const &motion) {
+    if (!motion_is_zero(motion)) {
+        if (!gyro_tracker.push_back({motion[AXIS_PITCH], motion[AXIS_YAW], motion[AXIS_ROLL]}) && !gyroHistoryOverflowed) {
+            LOG_WARN("Server: Motion lasted over {} ms, gyro compensation will not fully return to rest.", GYRO_HISTORY_MS);
+            gyroHistoryOverflowed = true;
+        }
     }
 }
 
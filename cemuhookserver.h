@@ -2,16 +2,25 @@
 #include "config.h"
 #include "crossSockets.h"
 #include "gamepad.h"
+#include "latencytrace.h"
+#include "motionmixer.h"
+#include "requestparser.h"
+#include "responsecurve.h"
+#include "shmpublisher.h"
 #include <SDL2/SDL_gamecontroller.h>
 
 #include <array>
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <string>
 #include <thread>
 #include <vector>
 
 using namespace cemuhook_protocol;
 
+#define GYRO_HISTORY_MS 60000 // Longest continuous motion gyro compensation can undo
+
 class Server {
   public:
     explicit Server(const Config *cfg, Gamepad *gamepad);
@@ -19,7 +28,10 @@ class Server {
     void Stop();
 
   private:
+    // Clients live in a pool of max_clients entries allocated at startup, so subscribing never allocates.
+    // The receive thread fills a free entry and then sets active, the send thread only reads active entries.
     struct Client {
+        std::atomic<bool> active{false};
         sockaddr_in address;
         uint32_t id;
         int sendTimeout;
@@ -31,15 +43,62 @@ class Server {
     struct Gyro_Compensation_Data {
         // Every non-zero motion sample is recorded here while it happens,
         // so it can be replayed in reverse once motion stops.
+        // Sized once for GYRO_HISTORY_MS at the send rate, once full the oldest samples are
+        // overwritten and the controller no longer returns to its exact rest position.
         std::vector<std::array<float, 3>> history;
+        size_t start = 0;
+        size_t count = 0;
+
+        bool empty() const {
+            return count == 0;
+        }
+
+        // Returns false if the oldest sample had to be dropped
+        bool push_back(std::array<float, 3> const &sample) {
+            if (count == history.size()) {
+                history[start] = sample;
+                start = (start + 1) % history.size();
+                return false;
+            }
+            history[(start + count) % history.size()] = sample;
+            count++;
+            return true;
+        }
+
+        std::array<float, 3> const &back() const {
+            return history[(start + count - 1) % history.size()];
+        }
+
+        void pop_back() {
+            count--;
+        }
 
         void reset() {
-            history.clear();
+            start = 0;
+            count = 0;
         }
     };
 
+    struct AnalogMapping {
+        SDL_GameControllerAxis axis;
+        int target; // MotionAxis
+        int source; // Mixer source
+        ResponseCurve curve;
+    };
+
     const uint32_t serverPort;
+    const uint32_t sendIntervalUs;
     const bool gyro_compensation;
+    const bool latency_trace;
+    const bool sample_timestamps;
+    const bool multicast;
+    const int multicastTtl;
+    const bool multicastLoop;
+    sockaddr_in multicastAddr;
+    in_addr multicastInterface;
+    const bool shm_enabled;
+    const std::string shmName;
+    const uint32_t shmSlots;
     Gamepad *const gamepad = nullptr;
     bool stopFlag = false;
     int socketFd;
@@ -52,13 +111,31 @@ class Server {
     DataEvent dataAnswer;
     std::vector<Client> clients;
     Gyro_Compensation_Data gyro_tracker;
+    bool gyroHistoryOverflowed = false; // Warned about the current overflow, cleared once the history drains
+    MotionMixer mixer;
+    int autoShakeSource;
+    int compensationSource;
+    int firstButtonSource;
+    std::vector<AnalogMapping> analogMappings;
+    LatencyTracer tracer;
+    ShmPublisher shm;
+    RequestParser parser;
+    uint64_t tickSampleTime = 0; // Oldest controller sample consumed by the current packet, 0 if none
+    uint64_t stageTimes[LATENCY_STAGES] = {}; // When the current packet finished each stage, recorded once it is sent
+    uint64_t lastTimestamp = 0;  // Last motion timestamp sent with sample_timestamps, kept strictly increasing
 
     void run();
     void sendTask();
     void PrepareAnswerConstants();
+    void PrepareMotionSources(const Config *cfg);
+    void PrepareMulticast(const Config *cfg);
     void CalcCrcDataAnswer();
+    void handleRequest(RequestView const &request, sockaddr_in const &sockInClient);
     void handleClientsTimeout();
+    Client *findClient(sockaddr_in const *address);
+    bool hasClients();
     std::pair<uint16_t, void const *> PrepareInfoAnswer(uint8_t const &slot);
     std::pair<uint16_t, void const *> PrepareDataAnswer(uint32_t const &packet);
-    void proccess_gyro_compensation();
+    bool queue_gyro_compensation();
+    void record_gyro_compensation(MotionVector const &motion);
 };
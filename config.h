@@ -1,11 +1,33 @@
 #pragma once
+#include "logger.h"
 #include <SDL2/SDL_gamecontroller.h>
+#include <atomic>
 #include <cstdint>
+#include <limits>
+#include <string>
 #include <vector>
 
+// How a motion source is combined with the other active sources
+enum class BlendMode {
+    Sum,     // Added to the other Sum sources
+    Max,     // Largest magnitude per axis among the Max sources, added on top of Sum
+    Priority // Highest priority active source replaces everything else
+};
+
+enum class InputBackend {
+    Sdl,   // Physical controller through SDL
+    Script // Timeline replayed from input_script
+};
+
+struct MotionSourceConfig {
+    BlendMode mode = BlendMode::Sum;
+    int priority = 0;
+    float accLimit = std::numeric_limits<float>::infinity();  // Saturation for accX, accY, accZ
+    float gyroLimit = std::numeric_limits<float>::infinity(); // Saturation for pitch, yaw, roll
+};
+
 struct ConfiguredButton {
     SDL_GameControllerButton button;
-    bool pending;
     float accX;
     float accY;
     float accZ;
@@ -13,9 +35,13 @@ struct ConfiguredButton {
     float yaw;
     float roll;
 
-    ConfiguredButton(SDL_GameControllerButton btn, bool pend, float aX, float aY, float aZ, float p, float y, float r) {
+    // Handoff between the gamepad thread and the send thread in a single word: 0 when not
+    // pending, otherwise the monotonic time (us) of the oldest poll that saw the button pressed.
+    // The gamepad only sets it from 0, the server takes it with an exchange back to 0.
+    std::atomic<uint64_t> pendingSince{0};
+
+    ConfiguredButton(SDL_GameControllerButton btn, float aX, float aY, float aZ, float p, float y, float r) {
         button = btn;
-        pending = pend;
         accX = aX;
         accY = aY;
         accZ = aZ;
@@ -24,20 +50,59 @@ struct ConfiguredButton {
         roll = r;
     }
 
-    ConfiguredButton(int btn, bool pend, float aX, float aY, float aZ, float p, float y, float r) {
-        button = (SDL_GameControllerButton)btn;
-        pending = pend;
-        accX = aX;
-        accY = aY;
-        accZ = aZ;
-        pitch = p;
-        yaw = y;
-        roll = r;
+    ConfiguredButton(int btn, float aX, float aY, float aZ, float p, float y, float r)
+        : ConfiguredButton((SDL_GameControllerButton)btn, aX, aY, aZ, p, y, r) {}
+
+    // Copies only happen while loading the config, before any thread is started
+    ConfiguredButton(ConfiguredButton const &other)
+        : ConfiguredButton(other.button, other.accX, other.accY, other.accZ, other.pitch, other.yaw, other.roll) {
+        pendingSince = other.pendingSince.load();
     }
 };
 
+// Drives one motion axis proportionally to an analog stick or trigger
+struct ConfiguredAxis {
+    SDL_GameControllerAxis axis;
+    int target;     // MotionAxis that receives the value (0 accX ... 5 roll)
+    float deadzone; // Fraction of the range ignored around the center
+    float exponent; // Response curve, 1 is linear, higher is finer near the center
+    float scale;    // Output at full deflection
+};
+
 struct Config {
     bool gyro_compensation = false;
     uint32_t port = 26760;
+    uint32_t max_clients = 64; // Unicast subscribers served at once, the pool is allocated at startup
     std::vector<ConfiguredButton> buttons;
+    std::vector<ConfiguredAxis> axes;
+    LogLevel log_level = LogLevel::Info;
+
+    InputBackend input_backend = InputBackend::Sdl;
+    std::string input_script;
+    bool input_script_loop = false;
+    uint32_t poll_interval_us = 5000; // Controller poll period
+    uint32_t send_interval_us = 5000; // Data packet period
+
+    MotionSourceConfig buttons_blend;
+    MotionSourceConfig analog_blend;
+    MotionSourceConfig auto_shake_blend;
+    MotionSourceConfig compensation_blend;
+
+    // Saturation applied to the final composed motion
+    float acc_limit = std::numeric_limits<float>::infinity();
+    float gyro_limit = std::numeric_limits<float>::infinity();
+
+    bool multicast_enabled = false;               // Send data packets once to a multicast group instead of to every client
+    std::string multicast_group = "239.255.26.76"; // Must be an IPv4 multicast address
+    uint32_t multicast_port = 0;                   // 0 uses the server port + 1, so receivers on this machine can bind it
+    int multicast_ttl = 1;                         // 1 keeps packets on the local network
+    std::string multicast_interface = "0.0.0.0";   // Address of the interface to send from, 0.0.0.0 lets the system pick
+    bool multicast_loop = true;                    // Also deliver to receivers on this machine
+
+    bool shm_enabled = false;           // Also publish every packet to a shared memory ring (Linux only)
+    std::string shm_name = "/cemushake"; // POSIX shared memory object name
+    uint32_t shm_slots = 256;
+
+    bool latency_trace = false;     // Periodically print input to socket latency percentiles
+    bool sample_timestamps = false; // Stamp packets with the controller sample time (monotonic) instead of build time
 };
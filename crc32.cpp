@@ -0,0 +1,47 @@
+#include "crc32.h"
+
+namespace {
+
+// Slicing-by-8 tables, table[k][b] is the CRC of byte b followed by k zero bytes
+struct Crc32Tables {
+    uint32_t table[8][256];
+
+    constexpr Crc32Tables() : table() {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t crc = i;
+            for (int k = 0; k < 8; k++)
+                crc = crc & 1 ? (crc >> 1) ^ 0xedb88320 : crc >> 1;
+            table[0][i] = crc;
+        }
+        for (uint32_t i = 0; i < 256; i++) {
+            for (int k = 1; k < 8; k++)
+                table[k][i] = (table[k - 1][i] >> 8) ^ table[0][table[k - 1][i] & 0xFF];
+        }
+    }
+};
+
+constexpr Crc32Tables tables;
+
+inline uint32_t load_le32(const unsigned char *s) {
+    return uint32_t(s[0]) | uint32_t(s[1]) << 8 | uint32_t(s[2]) << 16 | uint32_t(s[3]) << 24;
+}
+
+} // namespace
+
+uint32_t crc32Update(uint32_t crc, const unsigned char *s, size_t n) {
+    auto const &t = tables.table;
+
+    while (n >= 8) {
+        uint32_t one = load_le32(s) ^ crc;
+        uint32_t two = load_le32(s + 4);
+        crc = t[7][one & 0xFF] ^ t[6][(one >> 8) & 0xFF] ^ t[5][(one >> 16) & 0xFF] ^ t[4][one >> 24] ^
+              t[3][two & 0xFF] ^ t[2][(two >> 8) & 0xFF] ^ t[1][(two >> 16) & 0xFF] ^ t[0][two >> 24];
+        s += 8;
+        n -= 8;
+    }
+
+    while (n--)
+        crc = (crc >> 8) ^ t[0][(crc ^ *s++) & 0xFF];
+
+    return crc;
+}
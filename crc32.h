@@ -0,0 +1,18 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// CRC-32 (IEEE, reflected), the checksum used by the cemuhook protocol.
+// crc32Update() can be chained to checksum a buffer in pieces: start with CRC32_INIT
+// and pass the final value to crc32Final().
+#define CRC32_INIT 0xFFFFFFFFu
+
+uint32_t crc32Update(uint32_t crc, const unsigned char *s, size_t n);
+
+inline uint32_t crc32Final(uint32_t crc) {
+    return ~crc;
+}
+
+inline uint32_t crc32(const unsigned char *s, size_t n) {
+    return crc32Final(crc32Update(CRC32_INIT, s, n));
+}
@@ -1,4 +1,5 @@
 #include "crossSockets.h"
+#include "logger.h"
 
 namespace crossSockets {
 
@@ -36,7 +37,7 @@ void initializeSockets() {
 
     // Initialize Winsock (Windows-specific).
     if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
-        std::cout << "Server: Winsock initialization failed. Error: " << WSAGetLastError() << std::endl;
+        LOG_ERROR("Server: Winsock initialization failed. Error: {}", WSAGetLastError());
         return;
     }
 #endif
@@ -49,17 +50,37 @@ void setSocketToNonBlocking(int &socketFd) {
     int flags = fcntl(socketFd, F_GETFL, 0);
 
     if (fcntl(socketFd, F_SETFL, flags | O_NONBLOCK) == -1) {
-        std::cout << "fcntl(F_SETFL) failed\n";
+        LOG_ERROR("fcntl(F_SETFL) failed");
     }
     return;
 #endif
 #ifdef _WIN32
     u_long mode = 1; // 1 for non-blocking, 0 for blocking
     if (ioctlsocket(socketFd, FIONBIO, &mode) != 0) {
-        std::cout << "ioctlsocket() failed\n";
+        LOG_ERROR("ioctlsocket() failed");
     }
     return;
 #endif
 }
 
+bool setMulticastOptions(int socketFd, int ttl, in_addr const &interfaceAddr, bool loop) {
+#ifdef __unix__
+    int loopValue = loop ? 1 : 0;
+    bool ok = setsockopt(socketFd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl)) == 0;
+    ok = setsockopt(socketFd, IPPROTO_IP, IP_MULTICAST_IF, &interfaceAddr, sizeof(interfaceAddr)) == 0 && ok;
+    ok = setsockopt(socketFd, IPPROTO_IP, IP_MULTICAST_LOOP, &loopValue, sizeof(loopValue)) == 0 && ok;
+#endif
+#ifdef _WIN32
+    DWORD ttlValue = ttl;
+    DWORD loopValue = loop ? 1 : 0;
+    bool ok = setsockopt(socketFd, IPPROTO_IP, IP_MULTICAST_TTL, (const char *)&ttlValue, sizeof(ttlValue)) == 0;
+    ok = setsockopt(socketFd, IPPROTO_IP, IP_MULTICAST_IF, (const char *)&interfaceAddr, sizeof(interfaceAddr)) == 0 && ok;
+    ok = setsockopt(socketFd, IPPROTO_IP, IP_MULTICAST_LOOP, (const char *)&loopValue, sizeof(loopValue)) == 0 && ok;
+#endif
+    if (!ok) {
+        LOG_ERROR("Server: Could not set multicast options.");
+    }
+    return ok;
+}
+
 } // namespace crossSockets
\ No newline at end of file
@@ -31,5 +31,6 @@ ssize_t SendPacket(int const &socketFd, std::pair<uint16_t, void const *> const
 void setSocketOptionsTimeout(int socketFd, int secs);
 void initializeSockets();
 void setSocketToNonBlocking(int &socketFd);
+bool setMulticastOptions(int socketFd, int ttl, in_addr const &interfaceAddr, bool loop);
 
 } // namespace crossSockets
\ No newline at end of file
@@ -0,0 +1,50 @@
+// libFuzzer/AFL++ harness for RequestParser, see 'make fuzz'.
+// Build with -DFUZZ_STANDALONE to replay files (e.g. fuzz/corpus/*) without libFuzzer.
+#include "../requestparser.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    // Copy into an exactly sized buffer so ASan catches any read past the received length
+    unsigned char *buf = new unsigned char[size];
+    std::memcpy(buf, data, size);
+
+    RequestParser parser;
+    RequestView view;
+    if (parser.Parse(buf, size, view) == PARSE_OK) {
+        // Touch everything the server reads from an accepted request
+        volatile uint32_t sink = view.header->id + view.header->eventType;
+        if (view.header->eventType == INFO_TYPE) {
+            for (int i = 0; i < view.info().portCnt; i++)
+                sink = sink + view.info().slots[i];
+        } else if (view.header->eventType == DATA_TYPE) {
+            sink = sink + view.subscribe().slot;
+        }
+        (void)sink;
+    }
+
+    delete[] buf;
+    return 0;
+}
+
+#ifdef FUZZ_STANDALONE
+#include <cstdio>
+#include <vector>
+
+int main(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        FILE *file = std::fopen(argv[i], "rb");
+        if (file == nullptr)
+            continue;
+        std::vector<uint8_t> data;
+        int c;
+        while ((c = std::fgetc(file)) != EOF)
+            data.push_back(static_cast<uint8_t>(c));
+        std::fclose(file);
+        LLVMFuzzerTestOneInput(data.data(), data.size());
+    }
+    return 0;
+}
+#endif
@@ -1,28 +1,18 @@
 #include "gamepad.h"
-#include <iostream>
+#include "latencytrace.h"
+#include "logger.h"
+#include <algorithm>
 
 #define CONTROLLER_WAIT_MS 1000
-#define THREAD_SLEEP_TIME_MS 5
 #define AUTO_SHAKE_DUR_MS 4000
-constexpr uint16_t AUTO_SHAKE_DUR = AUTO_SHAKE_DUR_MS / THREAD_SLEEP_TIME_MS;
 
-using std::cout;
 using namespace std::chrono;
 
-SDL_GameController *findController() {
-    SDL_JoystickUpdate();
-    for (int i = 0; i < SDL_NumJoysticks(); i++) {
-        if (SDL_IsGameController(i)) {
-            return SDL_GameControllerOpen(i);
-        }
-    }
-
-    return nullptr;
-}
-
-Gamepad::Gamepad(std::vector<ConfiguredButton> buttons)
-    : configButtons_(std::move(buttons)) {
-    controller_ = findController();
+Gamepad::Gamepad(std::vector<ConfiguredButton> buttons, std::unique_ptr<InputSource> input, uint32_t pollIntervalUs)
+    : configButtons_(std::move(buttons)),
+      input_(std::move(input)),
+      pollIntervalUs_(pollIntervalUs) {
+    input_->Connect();
 }
 
 void Gamepad::Start() {
@@ -45,57 +35,72 @@ bool Gamepad::IsAutomaticShakeActive() const {
     return automaticShake_;
 }
 
-void Gamepad::processAutoShake() {
-    if (!automaticShake_ && SDL_GameControllerGetButton(controller_, SDL_CONTROLLER_BUTTON_BACK) &&
-        SDL_GameControllerGetButton(controller_, SDL_CONTROLLER_BUTTON_START)) {
-        cout << "Automatic shake started\n";
+uint64_t Gamepad::LastSampleTime() const {
+    return lastSampleTime_;
+}
+
+int16_t Gamepad::GetAxis(SDL_GameControllerAxis axis) const {
+    return axes_[axis].load(std::memory_order_relaxed);
+}
+
+void Gamepad::processAutoShake(uint64_t sampleTime) {
+    if (!automaticShake_ && input_->GetButton(SDL_CONTROLLER_BUTTON_BACK) &&
+        input_->GetButton(SDL_CONTROLLER_BUTTON_START)) {
+        LOG_INFO("Automatic shake started");
         automaticShake_ = true;
+        automaticShakeStart_ = sampleTime;
     }
 
-    static uint16_t automatic_cnt = 0;
-    if (automaticShake_) {
-        automatic_cnt++;
-
-        if (automatic_cnt == AUTO_SHAKE_DUR) {
-            cout << "Automatic shake ended\n";
-            automaticShake_ = false;
-            automatic_cnt = 0;
-        }
+    if (automaticShake_ && sampleTime - automaticShakeStart_ >= AUTO_SHAKE_DUR_MS * 1000ULL) {
+        LOG_INFO("Automatic shake ended");
+        automaticShake_ = false;
     }
 }
 
 void Gamepad::run() {
+    steady_clock::time_point nextPoll = steady_clock::now();
+
     while (!stopFlag_) {
-        if (controller_ == nullptr) {
-            controller_ = findController();
-            while (controller_ == nullptr && !stopFlag_) {
-                controller_ = findController();
+        if (!input_->IsConnected()) {
+            // Do not leave the sticks deflected while the controller is gone
+            for (auto &axis : axes_) {
+                axis.store(0, std::memory_order_relaxed);
+            }
+            while (!input_->Connect() && !stopFlag_) {
                 std::this_thread::sleep_for(milliseconds(CONTROLLER_WAIT_MS));
             }
             if (!stopFlag_)
-                cout << "Controller reconnected\n";
+                LOG_INFO("Controller reconnected");
+            nextPoll = steady_clock::now();
         }
 
-        SDL_GameControllerUpdate();
+        input_->Update();
+        uint64_t sampleTime = std::max<uint64_t>(MonotonicMicros(), 1); // 0 is reserved for "not pending"
+        lastSampleTime_ = sampleTime;
 
-        processAutoShake();
+        processAutoShake(sampleTime);
+
+        for (int axis = 0; axis < SDL_CONTROLLER_AXIS_MAX; axis++) {
+            axes_[axis].store(input_->GetAxis(static_cast<SDL_GameControllerAxis>(axis)), std::memory_order_relaxed);
+        }
 
         for (size_t i = 0; i < configButtons_.size(); i++) {
-            if (SDL_GameControllerGetButton(controller_, configButtons_[i].button)) {
-                configButtons_[i].pending = true;
+            if (input_->GetButton(configButtons_[i].button)) {
+                // Only set when the server took the previous press, so the oldest sample is kept
+                uint64_t notPending = 0;
+                configButtons_[i].pendingSince.compare_exchange_strong(notPending, sampleTime, std::memory_order_release, std::memory_order_relaxed);
             }
         }
 
-        std::this_thread::sleep_for(milliseconds(THREAD_SLEEP_TIME_MS));
+        // Sleep until an absolute deadline so the poll rate does not drift with the loop cost
+        nextPoll += microseconds(pollIntervalUs_);
+        steady_clock::time_point now = steady_clock::now();
+        if (nextPoll < now)
+            nextPoll = now;
+        std::this_thread::sleep_until(nextPoll);
     }
 }
 
 void Gamepad::HandleControllerDisconnected(SDL_Event const &event) {
-    if (event.type == SDL_CONTROLLERDEVICEREMOVED) {
-        cout << "Controller disconnected\n";
-        if (controller_ && event.cdevice.which == SDL_JoystickInstanceID(SDL_GameControllerGetJoystick(controller_))) {
-            SDL_GameControllerClose(controller_);
-            controller_ = nullptr;
-        }
-    }
-}
\ No newline at end of file
+    input_->HandleEvent(event);
+}
@@ -1,26 +1,34 @@
 #pragma once
 #include "config.h"
+#include "inputsource.h"
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_gamecontroller.h>
 #include <atomic>
+#include <memory>
 #include <thread>
 #include <vector>
 
 class Gamepad {
   public:
-    explicit Gamepad(std::vector<ConfiguredButton> buttons);
+    Gamepad(std::vector<ConfiguredButton> buttons, std::unique_ptr<InputSource> input, uint32_t pollIntervalUs);
     void Start();
     void Stop();
     std::vector<ConfiguredButton> &GetButtonStates();
     bool IsAutomaticShakeActive() const;
+    uint64_t LastSampleTime() const;                       // Monotonic time (us) of the latest controller poll
+    int16_t GetAxis(SDL_GameControllerAxis axis) const;    // Axis value from the latest controller poll
     void HandleControllerDisconnected(SDL_Event const &event); // called from main thread when controller is disconnected
   private:
     std::vector<ConfiguredButton> configButtons_;
+    std::unique_ptr<InputSource> input_;
+    const uint32_t pollIntervalUs_;
     std::atomic<bool> stopFlag_{false};
     std::atomic<bool> automaticShake_{false};
+    uint64_t automaticShakeStart_ = 0;
     std::unique_ptr<std::thread> thread_;
-    std::atomic<SDL_GameController *> controller_{nullptr};
+    std::atomic<uint64_t> lastSampleTime_{0};
+    std::atomic<int16_t> axes_[SDL_CONTROLLER_AXIS_MAX] = {};
 
     void run();
-    void processAutoShake();
-};
\ No newline at end of file
+    void processAutoShake(uint64_t sampleTime);
+};
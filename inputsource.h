@@ -0,0 +1,17 @@
+#pragma once
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_gamecontroller.h>
+#include <cstdint>
+
+// Where Gamepad reads the controller state from. All methods except HandleEvent()
+// are only called from the gamepad thread.
+class InputSource {
+  public:
+    virtual ~InputSource() = default;
+    virtual bool Connect() = 0; // Tries to open the device, returns true if it is ready to be polled
+    virtual bool IsConnected() const = 0;
+    virtual void Update() = 0; // Refreshes the state returned by GetButton() and GetAxis(), called once per poll
+    virtual bool GetButton(SDL_GameControllerButton button) const = 0;
+    virtual int16_t GetAxis(SDL_GameControllerAxis axis) const = 0; // Raw SDL value, -32768 to 32767
+    virtual void HandleEvent(SDL_Event const &/*event*/) {} // Called from main thread with every SDL event
+};
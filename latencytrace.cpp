@@ -0,0 +1,118 @@
+#include "latencytrace.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <chrono>
+
+using namespace std::chrono;
+
+namespace {
+
+const char *stage_name(int stage) {
+    switch (stage) {
+    case STAGE_HANDOFF:
+        return "handoff";
+    case STAGE_BUILD:
+        return "build";
+    case STAGE_CRC:
+        return "crc";
+    case STAGE_SEND:
+        return "send";
+    }
+    return "unknown";
+}
+
+int highest_bit(uint64_t value) {
+    int bit = 0;
+    while (value >>= 1)
+        bit++;
+    return bit;
+}
+
+} // namespace
+
+uint64_t MonotonicMicros() {
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+uint32_t LatencyHistogram::bucketFor(uint64_t us) {
+    if (us < LATENCY_LINEAR_BUCKETS)
+        return us;
+
+    int exponent = highest_bit(us);
+    if (exponent > LATENCY_MAX_EXPONENT)
+        return LATENCY_BUCKETS - 1;
+
+    uint32_t sub = (us >> (exponent - 4)) & (LATENCY_SUB_BUCKETS - 1);
+    return LATENCY_LINEAR_BUCKETS + (exponent - 6) * LATENCY_SUB_BUCKETS + sub;
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(uint32_t bucket) {
+    if (bucket < LATENCY_LINEAR_BUCKETS)
+        return bucket;
+
+    uint32_t exponent = (bucket - LATENCY_LINEAR_BUCKETS) / LATENCY_SUB_BUCKETS + 6;
+    uint64_t sub = (bucket - LATENCY_LINEAR_BUCKETS) % LATENCY_SUB_BUCKETS;
+    uint64_t step = 1ULL << (exponent - 4);
+    return (1ULL << exponent) + (sub + 1) * step - 1;
+}
+
+void LatencyHistogram::Record(uint64_t us) {
+    buckets_[bucketFor(us)].fetch_add(1, std::memory_order_relaxed);
+
+    uint64_t prevMax = max_.load(std::memory_order_relaxed);
+    while (us > prevMax && !max_.compare_exchange_weak(prevMax, us, std::memory_order_relaxed)) {
+    }
+}
+
+uint64_t LatencyHistogram::Count() const {
+    uint64_t count = 0;
+    for (auto const &bucket : buckets_)
+        count += bucket.load(std::memory_order_relaxed);
+    return count;
+}
+
+uint64_t LatencyHistogram::Max() const {
+    return max_.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::Percentile(double p) const {
+    uint64_t count = Count();
+    if (count == 0)
+        return 0;
+
+    uint64_t target = static_cast<uint64_t>(p / 100.0 * count);
+    if (target >= count)
+        target = count - 1;
+
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < LATENCY_BUCKETS; i++) {
+        seen += buckets_[i].load(std::memory_order_relaxed);
+        if (seen > target)
+            return std::min(bucketUpperBound(i), Max());
+    }
+    return Max();
+}
+
+void LatencyHistogram::Reset() {
+    for (auto &bucket : buckets_)
+        bucket.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+void LatencyTracer::Record(LatencyStage stage, uint64_t sampleTime, uint64_t now) {
+    stages_[stage].Record(now > sampleTime ? now - sampleTime : 0);
+}
+
+void LatencyTracer::Report() {
+    if (stages_[STAGE_HANDOFF].Count() == 0)
+        return;
+
+    LOG_INFO("Latency (us):");
+    for (int i = 0; i < LATENCY_STAGES; i++) {
+        LatencyHistogram &hist = stages_[i];
+        LOG_INFO("  {} p50: {} p90: {} p99: {} max: {} n: {}",
+                 stage_name(i), hist.Percentile(50), hist.Percentile(90), hist.Percentile(99), hist.Max(), hist.Count());
+        hist.Reset();
+    }
+}
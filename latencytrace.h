@@ -0,0 +1,46 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+#define LATENCY_LINEAR_BUCKETS 64 // 1us resolution below this
+#define LATENCY_SUB_BUCKETS 16    // Per power of two above it, ~6% resolution
+#define LATENCY_MAX_EXPONENT 40
+#define LATENCY_BUCKETS (LATENCY_LINEAR_BUCKETS + (LATENCY_MAX_EXPONENT - 6 + 1) * LATENCY_SUB_BUCKETS)
+
+// Monotonic clock used for every input and pipeline timestamp, in microseconds
+uint64_t MonotonicMicros();
+
+// Fixed-size log-linear histogram. Recording is a single relaxed atomic increment.
+class LatencyHistogram {
+  public:
+    void Record(uint64_t us);
+    uint64_t Percentile(double p) const;
+    uint64_t Max() const;
+    uint64_t Count() const;
+    void Reset();
+
+  private:
+    std::atomic<uint32_t> buckets_[LATENCY_BUCKETS] = {};
+    std::atomic<uint64_t> max_{0};
+
+    static uint32_t bucketFor(uint64_t us);
+    static uint64_t bucketUpperBound(uint32_t bucket);
+};
+
+enum LatencyStage {
+    STAGE_HANDOFF, // Gamepad sample -> picked up by the server
+    STAGE_BUILD,   // Gamepad sample -> DataEvent filled in
+    STAGE_CRC,     // Gamepad sample -> CRC computed
+    STAGE_SEND,    // Gamepad sample -> sendto returned
+    LATENCY_STAGES
+};
+
+// Tracks how long it takes for a button press to reach the socket, one histogram per pipeline stage
+class LatencyTracer {
+  public:
+    void Record(LatencyStage stage, uint64_t sampleTime, uint64_t now);
+    void Report(); // Prints the percentiles of every stage and starts a new window
+
+  private:
+    LatencyHistogram stages_[LATENCY_STAGES];
+};
@@ -0,0 +1,192 @@
+#include "logger.h"
+#include "crossSockets.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <thread>
+
+using namespace std::chrono;
+
+#define LOG_RING_SIZE 1024 // Must be a power of two
+#define LOG_LINE_LEN 512
+#define LOG_IDLE_SLEEP_MS 10
+
+namespace logger {
+
+std::atomic<LogLevel> currentLevel{LogLevel::Info};
+
+namespace {
+
+static_assert((LOG_RING_SIZE & (LOG_RING_SIZE - 1)) == 0, "Log ring size must be a power of two");
+
+// Bounded multi-producer queue, every slot carries the sequence number it is ready for
+// so producers only contend on enqueuePos and the single consumer never blocks them.
+struct Ring {
+    Record records[LOG_RING_SIZE];
+    alignas(64) std::atomic<uint64_t> enqueuePos{0};
+    alignas(64) uint64_t dequeuePos = 0;
+    std::atomic<uint64_t> dropped{0};
+
+    Ring() {
+        for (uint64_t i = 0; i < LOG_RING_SIZE; i++)
+            records[i].seq.store(i, std::memory_order_relaxed);
+    }
+};
+
+Ring ring;
+std::atomic<bool> stopFlag{false};
+std::unique_ptr<std::thread> writerThread;
+
+size_t append(char *line, size_t used, const char *str, size_t len) {
+    if (used + len > LOG_LINE_LEN - 1)
+        len = LOG_LINE_LEN - 1 - used;
+    std::memcpy(line + used, str, len);
+    return used + len;
+}
+
+size_t formatArg(Record const &record, Arg const &arg, char *line, size_t used) {
+    char buf[INET6_ADDRSTRLEN];
+    int len = 0;
+
+    switch (arg.type) {
+    case Arg::Int:
+        len = snprintf(buf, sizeof(buf), "%lld", static_cast<long long>(arg.i));
+        break;
+    case Arg::UInt:
+        len = snprintf(buf, sizeof(buf), "%llu", static_cast<unsigned long long>(arg.u));
+        break;
+    case Arg::Float:
+        len = snprintf(buf, sizeof(buf), "%g", arg.f);
+        break;
+    case Arg::Text:
+        return append(line, used, record.text + arg.text.offset, arg.text.length);
+    case Arg::Address: {
+        sockaddr_in addr = sockaddr_in();
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = arg.ip;
+        buf[0] = 0;
+        const char *ip = crossSockets::GetIP(addr, buf);
+        return append(line, used, ip ? ip : "?", ip ? strlen(ip) : 1);
+    }
+    }
+
+    if (len < 0)
+        return used;
+    return append(line, used, buf, std::min<size_t>(len, sizeof(buf) - 1));
+}
+
+void writeRecord(Record const &record) {
+    char line[LOG_LINE_LEN];
+    size_t used = 0;
+    uint8_t nextArg = 0;
+
+    for (const char *c = record.format; *c != '\0'; c++) {
+        if (c[0] == '{' && c[1] == '}' && nextArg < record.argCount) {
+            used = formatArg(record, record.args[nextArg++], line, used);
+            c++;
+        } else {
+            used = append(line, used, c, 1);
+        }
+    }
+    line[used++] = '\n';
+
+    fwrite(line, 1, used, stdout);
+}
+
+// Writes everything queued so far, returns the number of messages written
+size_t drain() {
+    size_t written = 0;
+
+    for (;;) {
+        Record &record = ring.records[ring.dequeuePos & (LOG_RING_SIZE - 1)];
+        if (record.seq.load(std::memory_order_acquire) != ring.dequeuePos + 1)
+            break;
+
+        writeRecord(record);
+        record.seq.store(ring.dequeuePos + LOG_RING_SIZE, std::memory_order_release);
+        ring.dequeuePos++;
+        written++;
+    }
+
+    uint64_t dropped = ring.dropped.exchange(0, std::memory_order_relaxed);
+    if (dropped > 0)
+        fprintf(stdout, "Logger: %llu messages dropped\n", static_cast<unsigned long long>(dropped));
+
+    if (written > 0 || dropped > 0)
+        fflush(stdout);
+
+    return written;
+}
+
+void run() {
+    while (!stopFlag) {
+        if (drain() == 0)
+            std::this_thread::sleep_for(milliseconds(LOG_IDLE_SLEEP_MS));
+    }
+    drain();
+}
+
+} // namespace
+
+void SetLevel(LogLevel level) {
+    currentLevel.store(level, std::memory_order_relaxed);
+}
+
+bool ParseLevel(std::string const &name, LogLevel &level) {
+    if (name == "error")
+        level = LogLevel::Error;
+    else if (name == "warn")
+        level = LogLevel::Warn;
+    else if (name == "info")
+        level = LogLevel::Info;
+    else if (name == "debug")
+        level = LogLevel::Debug;
+    else
+        return false;
+    return true;
+}
+
+void Start() {
+    stopFlag = false;
+    writerThread.reset(new std::thread(run));
+}
+
+void Stop() {
+    stopFlag = true;
+    if (writerThread.get() != nullptr) {
+        writerThread->join();
+        writerThread.reset();
+    } else {
+        drain();
+    }
+}
+
+Record *BeginRecord() {
+    uint64_t pos = ring.enqueuePos.load(std::memory_order_relaxed);
+
+    for (;;) {
+        Record &record = ring.records[pos & (LOG_RING_SIZE - 1)];
+        uint64_t seq = record.seq.load(std::memory_order_acquire);
+        int64_t diff = static_cast<int64_t>(seq) - static_cast<int64_t>(pos);
+
+        if (diff == 0) {
+            if (ring.enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                return &record;
+        } else if (diff < 0) {
+            ring.dropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        } else {
+            pos = ring.enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void CommitRecord(Record *record) {
+    uint64_t pos = record->seq.load(std::memory_order_relaxed);
+    record->seq.store(pos + 1, std::memory_order_release);
+}
+
+} // namespace logger
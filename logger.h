@@ -0,0 +1,143 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+#define LOG_MAX_ARGS 6
+#define LOG_TEXT_LEN 128 // Shared by all string arguments of one message, longer strings are truncated
+
+enum class LogLevel : uint8_t {
+    Error,
+    Warn,
+    Info,
+    Debug
+};
+
+// Messages are only formatted if their level is enabled. Any thread can log without allocating
+// or locking: arguments are copied into a fixed-size record pushed to a lock-free ring, and a
+// background thread formats and writes them. Messages use {} as placeholder for each argument.
+#define LOG_ERROR(...) LOG_AT(LogLevel::Error, __VA_ARGS__)
+#define LOG_WARN(...) LOG_AT(LogLevel::Warn, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(LogLevel::Info, __VA_ARGS__)
+#define LOG_DEBUG(...) LOG_AT(LogLevel::Debug, __VA_ARGS__)
+#define LOG_AT(level, ...)                      \
+    do {                                        \
+        if (logger::Enabled(level))             \
+            logger::Write(level, __VA_ARGS__);  \
+    } while (0)
+
+namespace logger {
+
+// IPv4 address in network byte order, formatted as text by the background thread
+struct Ipv4 {
+    uint32_t addr;
+};
+
+struct Arg {
+    enum Type : uint8_t {
+        Int,
+        UInt,
+        Float,
+        Text,
+        Address
+    } type;
+    union {
+        int64_t i;
+        uint64_t u;
+        double f;
+        uint32_t ip;
+        struct {
+            uint16_t offset;
+            uint16_t length;
+        } text;
+    };
+};
+
+struct Record {
+    std::atomic<uint64_t> seq;
+    LogLevel level;
+    uint8_t argCount;
+    uint16_t textUsed;
+    const char *format; // Must be a string literal
+    Arg args[LOG_MAX_ARGS];
+    char text[LOG_TEXT_LEN];
+};
+
+extern std::atomic<LogLevel> currentLevel;
+
+inline bool Enabled(LogLevel level) {
+    return level <= currentLevel.load(std::memory_order_relaxed);
+}
+
+void SetLevel(LogLevel level);
+bool ParseLevel(std::string const &name, LogLevel &level);
+void Start(); // Starts the writer thread, messages logged before are kept until then
+void Stop();  // Writes every pending message and stops the writer thread
+
+Record *BeginRecord(); // Reserves a slot in the ring, nullptr if it is full (the message is dropped)
+void CommitRecord(Record *record);
+
+inline void AddText(Record &record, const char *str, size_t len) {
+    Arg &arg = record.args[record.argCount++];
+    size_t room = LOG_TEXT_LEN - record.textUsed;
+    if (len > room)
+        len = room;
+    for (size_t i = 0; i < len; i++)
+        record.text[record.textUsed + i] = str[i];
+    arg.type = Arg::Text;
+    arg.text.offset = record.textUsed;
+    arg.text.length = len;
+    record.textUsed += len;
+}
+
+inline void AddArg(Record &record, const char *str) {
+    size_t len = 0;
+    while (str[len] != '\0' && len < LOG_TEXT_LEN)
+        len++;
+    AddText(record, str, len);
+}
+
+inline void AddArg(Record &record, std::string const &str) {
+    AddText(record, str.data(), str.size());
+}
+
+inline void AddArg(Record &record, Ipv4 const &address) {
+    Arg &arg = record.args[record.argCount++];
+    arg.type = Arg::Address;
+    arg.ip = address.addr;
+}
+
+template <typename T>
+inline typename std::enable_if<std::is_arithmetic<T>::value>::type AddArg(Record &record, T value) {
+    Arg &arg = record.args[record.argCount++];
+    if (std::is_floating_point<T>::value) {
+        arg.type = Arg::Float;
+        arg.f = value;
+    } else if (std::is_signed<T>::value) {
+        arg.type = Arg::Int;
+        arg.i = value;
+    } else {
+        arg.type = Arg::UInt;
+        arg.u = value;
+    }
+}
+
+template <typename... Args>
+void Write(LogLevel level, const char *format, Args const &...args) {
+    static_assert(sizeof...(Args) <= LOG_MAX_ARGS, "Too many log arguments");
+
+    Record *record = BeginRecord();
+    if (record == nullptr)
+        return;
+
+    record->level = level;
+    record->format = format;
+    record->argCount = 0;
+    record->textUsed = 0;
+    (AddArg(*record, args), ...);
+    CommitRecord(record);
+}
+
+} // namespace logger
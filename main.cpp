@@ -1,15 +1,17 @@
 #include "cemuhookserver.h"
 #include "config.h"
 #include "gamepad.h"
+#include "logger.h"
+#include "motionmixer.h"
+#include "scriptedinputsource.h"
+#include "sdlinputsource.h"
 #include <csignal>
 #include <cstdlib>
 #include <filesystem>
-#include <iostream>
 #include <string>
 #include <sys/types.h>
 #include <yaml-cpp/yaml.h>
 
-using std::cout;
 using namespace std::chrono;
 
 #define SLEEP_TIME_MS 100
@@ -18,11 +20,46 @@ bool stopFlag = false;
 
 void signalHandler(int signal) {
     if (signal == SIGINT) {
-        cout << "\nCtrl + C Received, Stopping...\n";
+        LOG_INFO("\nCtrl + C Received, Stopping...");
         stopFlag = true;
     }
 }
 
+BlendMode parseBlendMode(std::string const &mode) {
+    if (mode == "sum")
+        return BlendMode::Sum;
+    if (mode == "max")
+        return BlendMode::Max;
+    if (mode == "priority")
+        return BlendMode::Priority;
+
+    throw std::runtime_error("Unknown blend mode: " + mode);
+}
+
+MotionAxis parseMotionAxis(std::string const &target) {
+    static const char *const names[MOTION_AXES] = {"accX", "accY", "accZ", "pitch", "yaw", "roll"};
+    for (int i = 0; i < MOTION_AXES; i++) {
+        if (target == names[i])
+            return static_cast<MotionAxis>(i);
+    }
+
+    throw std::runtime_error("Unknown motion axis: " + target);
+}
+
+void readBlendConfig(YAML::Node const &node, MotionSourceConfig &blend) {
+    if (!node)
+        return;
+
+    if (node["mode"])
+        blend.mode = parseBlendMode(node["mode"].as<std::string>());
+    if (node["priority"])
+        blend.priority = node["priority"].as<int>();
+    if (node["acc_limit"])
+        blend.accLimit = node["acc_limit"].as<float>();
+    if (node["gyro_limit"])
+        blend.gyroLimit = node["gyro_limit"].as<float>();
+}
+
 Config *readConfig() {
     Config *configStruct = new Config();
 
@@ -39,16 +76,27 @@ Config *readConfig() {
         }
     }
 
+    if (!std::filesystem::exists(configPath)) {
+        LOG_WARN("No config file found, using defaults.");
+        return configStruct;
+    }
+
     try {
         YAML::Node configFile = YAML::LoadFile(configPath);
 
         configStruct->gyro_compensation = configFile["gyro_compensation"].as<bool>();
         configStruct->port = configFile["port"].as<uint32_t>();
+        if (configStruct->port == 0 || configStruct->port > UINT16_MAX)
+            throw std::runtime_error("Invalid port: " + std::to_string(configStruct->port));
+        if (configFile["max_clients"]) {
+            configStruct->max_clients = configFile["max_clients"].as<uint32_t>();
+            if (configStruct->max_clients == 0)
+                throw std::runtime_error("max_clients must be at least 1");
+        }
 
         for (std::size_t i = 0; i < configFile["buttons"].size(); i++) {
             configStruct->buttons.emplace_back(
                 configFile["buttons"][i]["id"].as<uint8_t>(),
-                false,
                 configFile["buttons"][i]["accX"].as<float>(),
                 configFile["buttons"][i]["accY"].as<float>(),
                 configFile["buttons"][i]["accZ"].as<float>(),
@@ -57,8 +105,105 @@ Config *readConfig() {
                 configFile["buttons"][i]["roll"].as<float>());
         }
 
-    } catch (...) {
-        cout << "[ERROR!] Could not load config file. Check spelling and that all settings have a value.\n";
+        for (std::size_t i = 0; i < configFile["axes"].size(); i++) {
+            YAML::Node axis = configFile["axes"][i];
+            int id = axis["id"].as<int>();
+            if (id < 0 || id >= SDL_CONTROLLER_AXIS_MAX)
+                throw std::runtime_error("Unknown controller axis: " + std::to_string(id));
+
+            float exponent = axis["exponent"] ? axis["exponent"].as<float>() : 1.0F;
+            if (!(exponent > 0.0F))
+                throw std::runtime_error("Axis exponent must be greater than 0: " + std::to_string(exponent));
+
+            configStruct->axes.push_back({
+                static_cast<SDL_GameControllerAxis>(id),
+                parseMotionAxis(axis["target"].as<std::string>()),
+                axis["deadzone"] ? axis["deadzone"].as<float>() : 0.1F,
+                exponent,
+                axis["scale"].as<float>(),
+            });
+        }
+
+        if (configFile["log_level"]) {
+            std::string level = configFile["log_level"].as<std::string>();
+            if (!logger::ParseLevel(level, configStruct->log_level))
+                throw std::runtime_error("Unknown log level: " + level);
+        }
+
+        if (configFile["acc_limit"])
+            configStruct->acc_limit = configFile["acc_limit"].as<float>();
+        if (configFile["gyro_limit"])
+            configStruct->gyro_limit = configFile["gyro_limit"].as<float>();
+
+        YAML::Node input = configFile["input"];
+        if (input) {
+            if (input["backend"]) {
+                std::string backend = input["backend"].as<std::string>();
+                if (backend == "sdl")
+                    configStruct->input_backend = InputBackend::Sdl;
+                else if (backend == "script")
+                    configStruct->input_backend = InputBackend::Script;
+                else
+                    throw std::runtime_error("Unknown input backend: " + backend);
+            }
+            if (input["script"])
+                configStruct->input_script = input["script"].as<std::string>();
+            if (input["loop"])
+                configStruct->input_script_loop = input["loop"].as<bool>();
+        }
+
+        if (configFile["poll_interval_us"])
+            configStruct->poll_interval_us = configFile["poll_interval_us"].as<uint32_t>();
+        if (configFile["send_interval_us"])
+            configStruct->send_interval_us = configFile["send_interval_us"].as<uint32_t>();
+        if (configStruct->poll_interval_us == 0 || configStruct->send_interval_us == 0)
+            throw std::runtime_error("poll_interval_us and send_interval_us must be at least 1");
+
+        YAML::Node multicast = configFile["multicast"];
+        if (multicast) {
+            if (multicast["enabled"])
+                configStruct->multicast_enabled = multicast["enabled"].as<bool>();
+            if (multicast["group"])
+                configStruct->multicast_group = multicast["group"].as<std::string>();
+            if (multicast["port"])
+                configStruct->multicast_port = multicast["port"].as<uint32_t>();
+            if (multicast["ttl"])
+                configStruct->multicast_ttl = multicast["ttl"].as<int>();
+            if (multicast["interface"])
+                configStruct->multicast_interface = multicast["interface"].as<std::string>();
+            if (multicast["loop"])
+                configStruct->multicast_loop = multicast["loop"].as<bool>();
+        }
+
+        YAML::Node shm = configFile["shm"];
+        if (shm) {
+            if (shm["enabled"])
+                configStruct->shm_enabled = shm["enabled"].as<bool>();
+            if (shm["name"])
+                configStruct->shm_name = shm["name"].as<std::string>();
+            if (shm["slots"])
+                configStruct->shm_slots = shm["slots"].as<uint32_t>();
+        }
+
+        if (configFile["latency_trace"])
+            configStruct->latency_trace = configFile["latency_trace"].as<bool>();
+        if (configFile["sample_timestamps"])
+            configStruct->sample_timestamps = configFile["sample_timestamps"].as<bool>();
+
+        YAML::Node blending = configFile["blending"];
+        if (blending) {
+            readBlendConfig(blending["buttons"], configStruct->buttons_blend);
+            readBlendConfig(blending["analog"], configStruct->analog_blend);
+            readBlendConfig(blending["auto_shake"], configStruct->auto_shake_blend);
+            readBlendConfig(blending["compensation"], configStruct->compensation_blend);
+        }
+
+    } catch (std::exception const &e) {
+        // Running with a half-applied config would silently ignore the rest of the file
+        LOG_ERROR("[ERROR!] Could not load config file {}: {}", configPath, e.what());
+        LOG_ERROR("Check spelling and that all settings have a value.");
+        delete configStruct;
+        return nullptr;
     }
 
     return configStruct;
@@ -66,29 +211,64 @@ Config *readConfig() {
 
 int main(int argv, char **args) {
     std::signal(SIGINT, signalHandler);
+    logger::Start();
 
-    // Initialize SDL
+    Config *configStruct = readConfig();
+    if (configStruct == nullptr) {
+        logger::Stop();
+        return 1;
+    }
+    logger::SetLevel(configStruct->log_level);
+    if (configStruct->buttons.size() == 0) {
+        LOG_INFO("Using default config (R to shake).");
+        configStruct->buttons.emplace_back(SDL_CONTROLLER_BUTTON_RIGHTSHOULDER, 0.0f, 200.0f, 0.0f, 0.0f, 0.0f, 0.0f); // Default: RB = Shake up, no gyro;
+    }
+
+    // Initialize SDL, only required for a physical controller
     SDL_SetHint(SDL_HINT_JOYSTICK_THREAD, "1");
-    if (SDL_Init(SDL_INIT_GAMECONTROLLER) < 0) {
-        cout << "SDL could not initialize! SDL Error: " << SDL_GetError() << std::endl;
+    bool sdlReady = SDL_Init(SDL_INIT_GAMECONTROLLER) >= 0;
+    if (!sdlReady && configStruct->input_backend == InputBackend::Sdl) {
+        LOG_ERROR("SDL could not initialize! SDL Error: {}", SDL_GetError());
+        logger::Stop();
         return 1;
     }
 
-    Config *configStruct = readConfig();
-    if (configStruct->buttons.size() == 0) {
-        cout << "Using default config (R to shake).\n";
-        configStruct->buttons.emplace_back(SDL_CONTROLLER_BUTTON_RIGHTSHOULDER, false, 0.0f, 200.0f, 0.0f, 0.0f, 0.0f, 0.0f); // Default: RB = Shake up, no gyro;
+    std::unique_ptr<InputSource> input;
+    try {
+        if (configStruct->input_backend == InputBackend::Script) {
+            LOG_INFO("Replaying input script {}.", configStruct->input_script);
+            input.reset(new ScriptedInputSource(configStruct->input_script, configStruct->input_script_loop));
+        } else {
+            input.reset(new SdlInputSource());
+        }
+    } catch (std::exception const &e) {
+        LOG_ERROR("[ERROR!] {}", e.what());
+        logger::Stop();
+        return 1;
     }
 
-    Gamepad gamepad(std::move(configStruct->buttons));
+    Gamepad gamepad(std::move(configStruct->buttons), std::move(input), configStruct->poll_interval_us);
     gamepad.Start();
-    Server server(configStruct, &gamepad);
-    server.Start();
+
+    // The server validates the motion sources and multicast settings while building
+    std::unique_ptr<Server> server;
+    try {
+        server.reset(new Server(configStruct, &gamepad));
+    } catch (std::exception const &e) {
+        LOG_ERROR("[ERROR!] {}", e.what());
+        delete configStruct;
+        gamepad.Stop();
+        if (sdlReady)
+            SDL_Quit();
+        logger::Stop();
+        return 1;
+    }
+    server->Start();
     delete configStruct;
 
     SDL_Event event;
     while (!stopFlag) {
-        while (SDL_PollEvent(&event)) {
+        while (sdlReady && SDL_PollEvent(&event)) {
             // Check for quit events
             if (event.type == SDL_QUIT) {
                 stopFlag = true;
@@ -101,8 +281,10 @@ int main(int argv, char **args) {
         std::this_thread::sleep_for(milliseconds(SLEEP_TIME_MS));
     }
 
-    server.Stop();
+    server->Stop();
     gamepad.Stop();
-    SDL_Quit();
+    if (sdlReady)
+        SDL_Quit();
+    logger::Stop();
     return 0;
 }
\ No newline at end of file
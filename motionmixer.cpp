@@ -0,0 +1,129 @@
+#include "motionmixer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+inline float clamp_abs(float value, float limit) {
+    return std::min(std::max(value, -limit), limit);
+}
+
+} // namespace
+
+MotionMixer::MotionMixer(float accLimit, float gyroLimit) {
+    outputLimits_[AXIS_ACC_X] = accLimit;
+    outputLimits_[AXIS_ACC_Y] = accLimit;
+    outputLimits_[AXIS_ACC_Z] = accLimit;
+    outputLimits_[AXIS_PITCH] = gyroLimit;
+    outputLimits_[AXIS_YAW] = gyroLimit;
+    outputLimits_[AXIS_ROLL] = gyroLimit;
+}
+
+int MotionMixer::AddSource(MotionSourceConfig const &cfg, bool compensated) {
+    if (sourceCount_ >= MAX_MOTION_SOURCES)
+        throw std::runtime_error("MotionMixer: Too many motion sources configured.");
+
+    int source = sourceCount_++;
+
+    limits_[AXIS_ACC_X][source] = cfg.accLimit;
+    limits_[AXIS_ACC_Y][source] = cfg.accLimit;
+    limits_[AXIS_ACC_Z][source] = cfg.accLimit;
+    limits_[AXIS_PITCH][source] = cfg.gyroLimit;
+    limits_[AXIS_YAW][source] = cfg.gyroLimit;
+    limits_[AXIS_ROLL][source] = cfg.gyroLimit;
+
+    sumMask_[source] = cfg.mode == BlendMode::Sum ? 1.0F : 0.0F;
+    maxMask_[source] = cfg.mode == BlendMode::Max ? 1.0F : 0.0F;
+    priorityMode_[source] = cfg.mode == BlendMode::Priority;
+    priority_[source] = cfg.priority;
+    allMask_[source] = 1.0F;
+    compensatedMask_[source] = compensated ? 1.0F : 0.0F;
+
+    return source;
+}
+
+void MotionMixer::Set(int source, float accX, float accY, float accZ, float pitch, float yaw, float roll) {
+    axes_[AXIS_ACC_X][source] = accX;
+    axes_[AXIS_ACC_Y][source] = accY;
+    axes_[AXIS_ACC_Z][source] = accZ;
+    axes_[AXIS_PITCH][source] = pitch;
+    axes_[AXIS_YAW][source] = yaw;
+    axes_[AXIS_ROLL][source] = roll;
+    active_[source] = 1.0F;
+}
+
+void MotionMixer::Set(int source, MotionVector const &motion) {
+    for (int axis = 0; axis < MOTION_AXES; axis++) {
+        axes_[axis][source] = motion[axis];
+    }
+    active_[source] = 1.0F;
+}
+
+void MotionMixer::Clear() {
+    std::fill(std::begin(active_), std::end(active_), 0.0F);
+}
+
+bool MotionMixer::AnyCompensatedActive() const {
+    for (int i = 0; i < sourceCount_; i++) {
+        if (active_[i] * compensatedMask_[i] != 0.0F)
+            return true;
+    }
+    return false;
+}
+
+MotionVector MotionMixer::Compose() const {
+    return compose(allMask_);
+}
+
+MotionVector MotionMixer::ComposeCompensated() const {
+    return compose(compensatedMask_);
+}
+
+// Sources whose mask is zero are left out as if they were inactive
+MotionVector MotionMixer::compose(float const *mask) const {
+    MotionVector out;
+
+    // A Priority source overrides everything, the highest priority wins and ties go to the first one added
+    int prioritySource = -1;
+    for (int i = 0; i < sourceCount_; i++) {
+        if (priorityMode_[i] && active_[i] * mask[i] != 0.0F && (prioritySource < 0 || priority_[i] > priority_[prioritySource]))
+            prioritySource = i;
+    }
+
+    for (int axis = 0; axis < MOTION_AXES; axis++) {
+        float const *values = axes_[axis];
+        float const *limits = limits_[axis];
+
+        if (prioritySource >= 0) {
+            out[axis] = clamp_abs(clamp_abs(values[prioritySource], limits[prioritySource]), outputLimits_[axis]);
+            continue;
+        }
+
+        // Reduce into MIXER_LANE_WIDTH partial results first so every step is a plain vertical
+        // SIMD operation, then fold the lanes. Inactive and unused sources are masked to zero.
+        float sum[MIXER_LANE_WIDTH] = {};
+        float max[MIXER_LANE_WIDTH] = {};
+        for (int base = 0; base < MAX_MOTION_SOURCES; base += MIXER_LANE_WIDTH) {
+            for (int lane = 0; lane < MIXER_LANE_WIDTH; lane++) {
+                int i = base + lane;
+                float value = clamp_abs(values[i], limits[i]) * active_[i] * mask[i];
+                float maxCandidate = value * maxMask_[i];
+                sum[lane] += value * sumMask_[i];
+                max[lane] = std::fabs(maxCandidate) > std::fabs(max[lane]) ? maxCandidate : max[lane];
+            }
+        }
+
+        float total = 0.0F;
+        float largest = 0.0F;
+        for (int lane = 0; lane < MIXER_LANE_WIDTH; lane++) {
+            total += sum[lane];
+            largest = std::fabs(max[lane]) > std::fabs(largest) ? max[lane] : largest;
+        }
+
+        out[axis] = clamp_abs(total + largest, outputLimits_[axis]);
+    }
+
+    return out;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include "config.h"
+#include <array>
+#include <cstddef>
+
+#define MAX_MOTION_SOURCES 32
+#define MIXER_LANE_WIDTH 8 // Sources reduced in parallel, keeps the reductions vectorizable
+
+enum MotionAxis {
+    AXIS_ACC_X,
+    AXIS_ACC_Y,
+    AXIS_ACC_Z,
+    AXIS_PITCH,
+    AXIS_YAW,
+    AXIS_ROLL,
+    MOTION_AXES
+};
+
+using MotionVector = std::array<float, MOTION_AXES>;
+
+// Blends every active motion contribution (buttons, auto shake, compensation...) into one sample.
+// Sources are stored as a structure of arrays with a fixed capacity, so Compose() always does
+// the same amount of work no matter how many sources are registered or active.
+class MotionMixer {
+  public:
+    MotionMixer(float accLimit, float gyroLimit);
+    // Returns the source index used by Set(). Only compensated sources are recorded for gyro
+    // compensation, continuous inputs like analog aiming must not be undone on release.
+    int AddSource(MotionSourceConfig const &cfg, bool compensated = true);
+    void Set(int source, float accX, float accY, float accZ, float pitch, float yaw, float roll);
+    void Set(int source, MotionVector const &motion);
+    void Clear(); // Marks every source as inactive, called at the start of every tick
+    bool AnyCompensatedActive() const;
+    MotionVector Compose() const;
+    MotionVector ComposeCompensated() const; // Same blend restricted to compensated sources
+
+  private:
+    static_assert(MAX_MOTION_SOURCES % MIXER_LANE_WIDTH == 0, "Source capacity must be a multiple of the lane width");
+
+    alignas(32) float axes_[MOTION_AXES][MAX_MOTION_SOURCES] = {};
+    alignas(32) float limits_[MOTION_AXES][MAX_MOTION_SOURCES] = {};
+    alignas(32) float active_[MAX_MOTION_SOURCES] = {};
+    alignas(32) float allMask_[MAX_MOTION_SOURCES] = {};
+    alignas(32) float compensatedMask_[MAX_MOTION_SOURCES] = {};
+    alignas(32) float sumMask_[MAX_MOTION_SOURCES] = {};
+    alignas(32) float maxMask_[MAX_MOTION_SOURCES] = {};
+    bool priorityMode_[MAX_MOTION_SOURCES] = {};
+    int priority_[MAX_MOTION_SOURCES] = {};
+    float outputLimits_[MOTION_AXES];
+    int sourceCount_ = 0;
+
+    MotionVector compose(float const *mask) const;
+};
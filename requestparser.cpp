@@ -0,0 +1,112 @@
+#include "requestparser.h"
+#include "crc32.h"
+
+#include <cstring>
+
+using namespace cemuhook_protocol;
+
+namespace {
+
+// The length field counts everything after the crc32 and id fields
+constexpr size_t LENGTH_OFFSET = offsetof(Header, eventType);
+constexpr size_t CRC_OFFSET = offsetof(Header, crc32);
+
+const unsigned char zeroCrc[sizeof(uint32_t)] = {};
+
+} // namespace
+
+ParseResult RequestParser::Parse(const unsigned char *buf, size_t len, RequestView &view) {
+    ParseResult result = validate(buf, len, view);
+    if (result != PARSE_OK)
+        rejected_[result]++;
+    return result;
+}
+
+ParseResult RequestParser::validate(const unsigned char *buf, size_t len, RequestView &view) const {
+    if (len < sizeof(Header))
+        return PARSE_TOO_SHORT;
+
+    Header const &header = *reinterpret_cast<Header const *>(buf);
+
+    if (std::memcmp(header.magic, "DSUC", sizeof(header.magic)) != 0)
+        return PARSE_BAD_MAGIC;
+    if (header.version != PROTOCOL_VERSION)
+        return PARSE_BAD_VERSION;
+
+    size_t packetLen = LENGTH_OFFSET + header.length;
+    if (packetLen < sizeof(Header) || packetLen > len)
+        return PARSE_BAD_LENGTH;
+
+    // Checksum computed as if the crc32 field was zero, without copying the packet
+    uint32_t crc = crc32Update(CRC32_INIT, buf, CRC_OFFSET);
+    crc = crc32Update(crc, zeroCrc, sizeof(zeroCrc));
+    crc = crc32Update(crc, buf + CRC_OFFSET + sizeof(zeroCrc), packetLen - CRC_OFFSET - sizeof(zeroCrc));
+    // Fuzz builds (see 'make fuzz') still compute the checksum but accept mismatches,
+    // otherwise almost no mutated input would get past this point
+#ifndef FUZZING_BUILD_MODE_UNSAFE_FOR_PRODUCTION
+    if (crc32Final(crc) != header.crc32)
+        return PARSE_BAD_CRC;
+#else
+    (void)crc;
+#endif
+
+    view.header = &header;
+    view.payload = buf + sizeof(Header);
+    view.payloadLen = packetLen - sizeof(Header);
+
+    switch (header.eventType) {
+    case VERSION_TYPE:
+        return PARSE_OK;
+    case INFO_TYPE: {
+        // Clients only send as many slot bytes as ports they ask for
+        if (view.payloadLen < sizeof(InfoRequest::portCnt))
+            return PARSE_BAD_PAYLOAD;
+        int32_t portCnt = view.info().portCnt;
+        if (portCnt < 0 || portCnt > static_cast<int32_t>(sizeof(InfoRequest::slots)) ||
+            view.payloadLen < sizeof(InfoRequest::portCnt) + portCnt)
+            return PARSE_BAD_PAYLOAD;
+        return PARSE_OK;
+    }
+    case DATA_TYPE:
+        if (view.payloadLen < sizeof(SubscribeRequest))
+            return PARSE_BAD_PAYLOAD;
+        return PARSE_OK;
+    }
+
+    return PARSE_BAD_TYPE;
+}
+
+uint64_t RequestParser::Rejected(ParseResult reason) const {
+    return rejected_[reason];
+}
+
+uint64_t RequestParser::RejectedTotal() const {
+    uint64_t total = 0;
+    for (int i = PARSE_OK + 1; i < PARSE_RESULTS; i++)
+        total += rejected_[i];
+    return total;
+}
+
+const char *RequestParser::Describe(ParseResult reason) {
+    switch (reason) {
+    case PARSE_OK:
+        return "ok";
+    case PARSE_TOO_SHORT:
+        return "too short";
+    case PARSE_BAD_MAGIC:
+        return "bad magic";
+    case PARSE_BAD_VERSION:
+        return "bad version";
+    case PARSE_BAD_LENGTH:
+        return "bad length";
+    case PARSE_BAD_CRC:
+        return "bad crc";
+    case PARSE_BAD_TYPE:
+        return "unknown type";
+    case PARSE_BAD_PAYLOAD:
+        return "bad payload";
+    case PARSE_RESULTS:
+        break;
+    }
+    return "unknown";
+}
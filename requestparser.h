@@ -0,0 +1,52 @@
+#pragma once
+#include "cemuhookprotocol.h"
+#include <cstddef>
+#include <cstdint>
+
+#define PROTOCOL_VERSION 1001
+
+#define VERSION_TYPE 0x100000
+#define INFO_TYPE 0x100001
+#define DATA_TYPE 0x100002
+
+enum ParseResult {
+    PARSE_OK,
+    PARSE_TOO_SHORT,   // Smaller than a header
+    PARSE_BAD_MAGIC,   // Not DSUC
+    PARSE_BAD_VERSION, // Not PROTOCOL_VERSION
+    PARSE_BAD_LENGTH,  // header.length does not fit in what was received
+    PARSE_BAD_CRC,
+    PARSE_BAD_TYPE,    // Unknown event type
+    PARSE_BAD_PAYLOAD, // Payload too small or invalid for its event type
+    PARSE_RESULTS
+};
+
+// Validated, zero-copy view over a received datagram. Only valid while the receive buffer is.
+struct RequestView {
+    cemuhook_protocol::Header const *header;
+    const unsigned char *payload; // Right after the header
+    size_t payloadLen;
+
+    cemuhook_protocol::InfoRequest const &info() const {
+        return *reinterpret_cast<cemuhook_protocol::InfoRequest const *>(payload);
+    }
+
+    cemuhook_protocol::SubscribeRequest const &subscribe() const {
+        return *reinterpret_cast<cemuhook_protocol::SubscribeRequest const *>(payload);
+    }
+};
+
+// Checks magic, version, length and CRC of client requests before anything reads them
+// and counts every rejected datagram by reason. Not thread safe, owned by the receive thread.
+class RequestParser {
+  public:
+    ParseResult Parse(const unsigned char *buf, size_t len, RequestView &view);
+    uint64_t Rejected(ParseResult reason) const;
+    uint64_t RejectedTotal() const;
+    static const char *Describe(ParseResult reason);
+
+  private:
+    uint64_t rejected_[PARSE_RESULTS] = {};
+
+    ParseResult validate(const unsigned char *buf, size_t len, RequestView &view) const;
+};
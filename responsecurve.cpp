@@ -0,0 +1,23 @@
+#include "responsecurve.h"
+
+#include <algorithm>
+#include <cmath>
+
+ResponseCurve::ResponseCurve(float deadzone, float exponent, float scale) {
+    deadzone = std::min(std::max(deadzone, 0.0F), 0.99F);
+
+    for (int i = 0; i < CURVE_TABLE_SIZE; i++) {
+        // Entry i sits at raw value i * 256 - 32768, normalized to [-1, 1]
+        int raw = i * (1 << (16 - CURVE_TABLE_BITS)) - 32768;
+        float x = std::min(std::max(raw / 32767.0F, -1.0F), 1.0F);
+        float magnitude = std::fabs(x);
+
+        if (magnitude <= deadzone) {
+            table_[i] = 0.0F;
+            continue;
+        }
+
+        float scaled = (magnitude - deadzone) / (1.0F - deadzone);
+        table_[i] = std::copysign(std::pow(scaled, exponent) * scale, x);
+    }
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <cstdint>
+
+#define CURVE_TABLE_BITS 8 // 256 segments over the raw axis range
+#define CURVE_TABLE_SIZE ((1 << CURVE_TABLE_BITS) + 1)
+
+// Maps a raw SDL axis value (-32768 to 32767) to a motion value:
+// a deadzone around the center, a power curve and a scale at full deflection.
+// The curve is computed once into a lookup table, so evaluating it is a table lookup
+// plus a linear interpolation between the two nearest entries.
+class ResponseCurve {
+  public:
+    ResponseCurve(float deadzone, float exponent, float scale);
+
+    float Evaluate(int16_t raw) const {
+        uint32_t index = static_cast<uint32_t>(raw + 32768);
+        uint32_t segment = index >> (16 - CURVE_TABLE_BITS);
+        float frac = (index & ((1 << (16 - CURVE_TABLE_BITS)) - 1)) * (1.0F / (1 << (16 - CURVE_TABLE_BITS)));
+        return table_[segment] + (table_[segment + 1] - table_[segment]) * frac;
+    }
+
+  private:
+    float table_[CURVE_TABLE_SIZE];
+};
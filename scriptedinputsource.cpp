@@ -0,0 +1,97 @@
+#include "scriptedinputsource.h"
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std::chrono;
+
+ScriptedInputSource::ScriptedInputSource(std::string const &path, bool loop)
+    : loop_(loop) {
+    load(path);
+}
+
+void ScriptedInputSource::load(std::string const &path) {
+    std::ifstream file(path);
+    if (!file)
+        throw std::runtime_error("Input script could not be opened: " + path);
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#')
+            continue;
+
+        std::istringstream lineStream(line);
+        double timeMs;
+        std::string kind;
+        int id;
+        int value;
+        if (!(lineStream >> timeMs >> kind >> id >> value) || timeMs < 0)
+            throw std::runtime_error("Input script: Invalid event at line " + std::to_string(lineNumber));
+
+        bool isAxis = kind == "axis";
+        bool valid = isAxis ? id >= 0 && id < SDL_CONTROLLER_AXIS_MAX && value >= INT16_MIN && value <= INT16_MAX
+                            : kind == "button" && id >= 0 && id < SDL_CONTROLLER_BUTTON_MAX;
+        if (!valid)
+            throw std::runtime_error("Input script: Invalid event at line " + std::to_string(lineNumber));
+
+        uint64_t timeUs = static_cast<uint64_t>(timeMs * 1000.0);
+        if (!timeline_.empty() && timeUs < timeline_.back().timeUs)
+            throw std::runtime_error("Input script: Events out of order at line " + std::to_string(lineNumber));
+
+        timeline_.push_back({timeUs, isAxis, id, value});
+    }
+
+    if (timeline_.empty())
+        throw std::runtime_error("Input script has no events: " + path);
+}
+
+bool ScriptedInputSource::Connect() {
+    next_ = 0;
+    start_ = steady_clock::now();
+    connected_ = true;
+    return true;
+}
+
+bool ScriptedInputSource::IsConnected() const {
+    return connected_;
+}
+
+void ScriptedInputSource::Update() {
+    uint64_t elapsedUs = duration_cast<microseconds>(steady_clock::now() - start_).count();
+    uint64_t lengthUs = timeline_.back().timeUs;
+
+    if (loop_ && lengthUs > 0 && elapsedUs >= lengthUs) {
+        // The loop period is the time of the last event. Finish the current pass, skip any
+        // whole passes missed by a slow poll and continue from the position in the current one.
+        apply(UINT64_MAX);
+        uint64_t passes = elapsedUs / lengthUs;
+        start_ += microseconds(passes * lengthUs);
+        elapsedUs %= lengthUs;
+        next_ = 0;
+    }
+
+    apply(elapsedUs);
+}
+
+void ScriptedInputSource::apply(uint64_t untilUs) {
+    while (next_ < timeline_.size() && timeline_[next_].timeUs <= untilUs) {
+        Event const &event = timeline_[next_++];
+        if (event.isAxis)
+            axes_[event.id] = event.value;
+        else
+            buttons_[event.id] = event.value != 0;
+    }
+}
+
+bool ScriptedInputSource::GetButton(SDL_GameControllerButton button) const {
+    return button >= 0 && button < SDL_CONTROLLER_BUTTON_MAX && buttons_[button];
+}
+
+int16_t ScriptedInputSource::GetAxis(SDL_GameControllerAxis axis) const {
+    return axis >= 0 && axis < SDL_CONTROLLER_AXIS_MAX ? axes_[axis] : 0;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include "inputsource.h"
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Replays a timeline of button presses and axis moves from a text file, no physical controller needed.
+// Every non-empty line that does not start with '#' is an event:
+//     <time_ms> button <id> <pressed>
+//     <time_ms> axis <id> <value>
+// time_ms is relative to the start of the script and can have decimals, ids use the same
+// values as the config file, pressed is 1 or 0 and value is the raw axis value (-32768 to 32767).
+// Events must be sorted by time.
+class ScriptedInputSource : public InputSource {
+  public:
+    ScriptedInputSource(std::string const &path, bool loop);
+    bool Connect() override;
+    bool IsConnected() const override;
+    void Update() override;
+    bool GetButton(SDL_GameControllerButton button) const override;
+    int16_t GetAxis(SDL_GameControllerAxis axis) const override;
+
+  private:
+    struct Event {
+        uint64_t timeUs;
+        bool isAxis;
+        int id;    // SDL_GameControllerButton or SDL_GameControllerAxis
+        int value; // Pressed state or axis value
+    };
+
+    std::vector<Event> timeline_;
+    const bool loop_;
+    bool connected_ = false;
+    size_t next_ = 0;
+    std::chrono::steady_clock::time_point start_;
+    bool buttons_[SDL_CONTROLLER_BUTTON_MAX] = {};
+    int16_t axes_[SDL_CONTROLLER_AXIS_MAX] = {};
+
+    void load(std::string const &path);
+    void apply(uint64_t untilUs); // Applies every pending event up to that script time
+};
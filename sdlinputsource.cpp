@@ -0,0 +1,49 @@
+#include "sdlinputsource.h"
+#include "logger.h"
+
+namespace {
+
+SDL_GameController *findController() {
+    SDL_JoystickUpdate();
+    for (int i = 0; i < SDL_NumJoysticks(); i++) {
+        if (SDL_IsGameController(i)) {
+            return SDL_GameControllerOpen(i);
+        }
+    }
+
+    return nullptr;
+}
+
+} // namespace
+
+bool SdlInputSource::Connect() {
+    controller_ = findController();
+    return controller_ != nullptr;
+}
+
+bool SdlInputSource::IsConnected() const {
+    return controller_ != nullptr;
+}
+
+void SdlInputSource::Update() {
+    SDL_GameControllerUpdate();
+}
+
+bool SdlInputSource::GetButton(SDL_GameControllerButton button) const {
+    return SDL_GameControllerGetButton(controller_, button);
+}
+
+int16_t SdlInputSource::GetAxis(SDL_GameControllerAxis axis) const {
+    return SDL_GameControllerGetAxis(controller_, axis);
+}
+
+void SdlInputSource::HandleEvent(SDL_Event const &event) {
+    if (event.type == SDL_CONTROLLERDEVICEREMOVED) {
+        LOG_INFO("Controller disconnected");
+        SDL_GameController *controller = controller_;
+        if (controller && event.cdevice.which == SDL_JoystickInstanceID(SDL_GameControllerGetJoystick(controller))) {
+            SDL_GameControllerClose(controller);
+            controller_ = nullptr;
+        }
+    }
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include "inputsource.h"
+#include <atomic>
+
+// Reads the first game controller found by SDL
+class SdlInputSource : public InputSource {
+  public:
+    bool Connect() override;
+    bool IsConnected() const override;
+    void Update() override;
+    bool GetButton(SDL_GameControllerButton button) const override;
+    int16_t GetAxis(SDL_GameControllerAxis axis) const override;
+    void HandleEvent(SDL_Event const &event) override;
+
+  private:
+    std::atomic<SDL_GameController *> controller_{nullptr};
+};
@@ -0,0 +1,108 @@
+#include "shmpublisher.h"
+
+#include <cstring>
+#include "logger.h"
+#include <new>
+
+using namespace cemushake_shm;
+
+ShmPublisher::~ShmPublisher() {
+    Close();
+}
+
+bool ShmPublisher::Open(std::string const &name, uint32_t slotCount) {
+#ifdef __linux__
+    Close();
+
+    if (slotCount == 0) {
+        LOG_ERROR("Shared memory: Ring needs at least one slot.");
+        return false;
+    }
+
+    size_t size = RingSize(slotCount);
+
+    // Start from a fresh object so readers of a previous run do not see stale data
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        LOG_ERROR("Shared memory: Could not create {}.", name);
+        return false;
+    }
+
+    if (ftruncate(fd, size) != 0) {
+        LOG_ERROR("Shared memory: Could not resize {}.", name);
+        close(fd);
+        shm_unlink(name.c_str());
+        return false;
+    }
+
+    void *mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED) {
+        LOG_ERROR("Shared memory: Could not map {}.", name);
+        shm_unlink(name.c_str());
+        return false;
+    }
+
+    name_ = name;
+    size_ = size;
+    writeIndex_ = 0;
+
+    header_ = new (mem) RingHeader();
+    header_->slotCount = slotCount;
+    header_->slotSize = sizeof(Slot);
+    header_->version = SHM_VERSION;
+    header_->writeIndex.store(0, std::memory_order_relaxed);
+    header_->futexWord.store(0, std::memory_order_relaxed);
+    header_->waiters.store(0, std::memory_order_relaxed);
+
+    slots_ = RingSlots(header_);
+    for (uint32_t i = 0; i < slotCount; i++) {
+        new (&slots_[i]) Slot();
+        slots_[i].seq.store(0, std::memory_order_relaxed);
+    }
+
+    // Readers check the magic last, so it is only valid once everything else is in place
+    std::atomic_thread_fence(std::memory_order_release);
+    header_->magic = SHM_MAGIC;
+
+    LOG_INFO("Shared memory: Publishing to {} ({} slots).", name, slotCount);
+    return true;
+#else
+    LOG_WARN("Shared memory: Not supported on this platform.");
+    return false;
+#endif
+}
+
+void ShmPublisher::Close() {
+#ifdef __linux__
+    if (header_ == nullptr)
+        return;
+
+    munmap(header_, size_);
+    shm_unlink(name_.c_str());
+    header_ = nullptr;
+    slots_ = nullptr;
+#endif
+}
+
+void ShmPublisher::Publish(cemuhook_protocol::DataEvent const &event) {
+#ifdef __linux__
+    if (header_ == nullptr)
+        return;
+
+    Slot &slot = slots_[writeIndex_ % header_->slotCount];
+
+    slot.seq.store(2 * writeIndex_ + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(&slot.event, &event, sizeof(event));
+    slot.seq.store(2 * writeIndex_ + 2, std::memory_order_release);
+
+    header_->writeIndex.store(++writeIndex_, std::memory_order_release);
+
+    // Only pay for the syscall when a reader is actually sleeping
+    header_->futexWord.fetch_add(1);
+    if (header_->waiters.load() > 0)
+        Futex(&header_->futexWord, FUTEX_WAKE, INT_MAX, nullptr);
+#endif
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include "cemuhookprotocol.h"
+#include "shmreader.h"
+#include <cstdint>
+#include <string>
+
+// Writer side of the shared memory transport, see shmreader.h for the layout and the reader.
+// Only one thread may call Publish().
+class ShmPublisher {
+  public:
+    ~ShmPublisher();
+    bool Open(std::string const &name, uint32_t slotCount);
+    void Close();
+    void Publish(cemuhook_protocol::DataEvent const &event);
+
+  private:
+    std::string name_;
+    cemushake_shm::RingHeader *header_ = nullptr;
+    cemushake_shm::Slot *slots_ = nullptr;
+    size_t size_ = 0;
+    uint64_t writeIndex_ = 0;
+};
@@ -0,0 +1,206 @@
+#pragma once
+// Header-only reader for the CemuShake shared memory transport (Linux only).
+//
+// The server publishes every DataEvent it builds into a ring of seqlock protected slots
+// in POSIX shared memory. Readers on the same host map the ring and copy events out
+// without any syscall, they can optionally sleep on a futex until the next publish.
+//
+//     cemushake_shm::ShmReader reader;
+//     if (reader.Open("/cemushake")) {
+//         cemuhook_protocol::DataEvent event;
+//         while (reader.Wait(1000)) {
+//             while (reader.ReadNext(event)) { ... }
+//         }
+//     }
+#include "cemuhookprotocol.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#ifdef __linux__
+#include <climits>
+#include <ctime>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace cemushake_shm {
+
+constexpr uint32_t SHM_MAGIC = 0x4D485343; // "CSHM"
+constexpr uint32_t SHM_VERSION = 1;
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free && std::atomic<uint64_t>::is_always_lock_free,
+              "Shared memory atomics must be lock free");
+
+struct alignas(64) Slot {
+    // 2 * index + 1 while event index is being written, 2 * index + 2 once it is complete
+    std::atomic<uint64_t> seq;
+    cemuhook_protocol::DataEvent event;
+};
+
+struct RingHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slotCount;
+    uint32_t slotSize;
+    alignas(64) std::atomic<uint64_t> writeIndex; // Number of events published so far
+    alignas(64) std::atomic<uint32_t> futexWord;  // Bumped on every publish, readers wait on it
+    std::atomic<uint32_t> waiters;                // Readers sleeping on futexWord, the writer only wakes if non-zero
+};
+
+inline size_t RingSize(uint32_t slotCount) {
+    return sizeof(RingHeader) + static_cast<size_t>(slotCount) * sizeof(Slot);
+}
+
+inline Slot *RingSlots(RingHeader *header) {
+    return reinterpret_cast<Slot *>(header + 1);
+}
+
+#ifdef __linux__
+
+inline long Futex(std::atomic<uint32_t> *word, int op, uint32_t value, timespec const *timeout) {
+    return syscall(SYS_futex, reinterpret_cast<uint32_t *>(word), op, value, timeout, nullptr, 0);
+}
+
+class ShmReader {
+  public:
+    ShmReader() = default;
+    ShmReader(ShmReader const &) = delete;
+    ShmReader &operator=(ShmReader const &) = delete;
+    ~ShmReader() { Close(); }
+
+    // Maps the ring published by the server under name, starting at the newest event
+    bool Open(char const *name) {
+        Close();
+
+        int fd = shm_open(name, O_RDWR, 0);
+        if (fd < 0)
+            return false;
+
+        struct stat st;
+        if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(RingHeader)) {
+            close(fd);
+            return false;
+        }
+
+        void *mem = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (mem == MAP_FAILED)
+            return false;
+
+        header_ = static_cast<RingHeader *>(mem);
+        size_ = st.st_size;
+
+        if (header_->magic != SHM_MAGIC || header_->version != SHM_VERSION || header_->slotSize != sizeof(Slot) ||
+            header_->slotCount == 0 || RingSize(header_->slotCount) > size_) {
+            Close();
+            return false;
+        }
+
+        slots_ = RingSlots(header_);
+        readIndex_ = header_->writeIndex.load(std::memory_order_acquire);
+        return true;
+    }
+
+    void Close() {
+        if (header_ != nullptr)
+            munmap(header_, size_);
+        header_ = nullptr;
+        slots_ = nullptr;
+        size_ = 0;
+    }
+
+    bool IsOpen() const { return header_ != nullptr; }
+
+    // Copies the next unread event, returns false if there is none.
+    // If the reader fell more than a ring behind, the overwritten events are counted in Dropped().
+    bool ReadNext(cemuhook_protocol::DataEvent &out) {
+        for (;;) {
+            uint64_t writeIndex = header_->writeIndex.load(std::memory_order_acquire);
+            if (readIndex_ >= writeIndex)
+                return false;
+
+            if (writeIndex - readIndex_ > header_->slotCount) {
+                dropped_ += writeIndex - readIndex_ - header_->slotCount;
+                readIndex_ = writeIndex - header_->slotCount;
+            }
+
+            if (tryRead(readIndex_, out)) {
+                readIndex_++;
+                return true;
+            }
+
+            // Overwritten while copying, skip ahead
+            dropped_++;
+            readIndex_++;
+        }
+    }
+
+    // Copies the newest event and skips everything before it, returns false if there is nothing new
+    bool ReadLatest(cemuhook_protocol::DataEvent &out) {
+        for (;;) {
+            uint64_t writeIndex = header_->writeIndex.load(std::memory_order_acquire);
+            if (readIndex_ >= writeIndex)
+                return false;
+
+            dropped_ += writeIndex - readIndex_ - 1;
+            readIndex_ = writeIndex - 1;
+            if (tryRead(readIndex_, out)) {
+                readIndex_++;
+                return true;
+            }
+        }
+    }
+
+    // Sleeps until a new event is published or timeoutMs passes, returns true if there is something to read
+    bool Wait(int timeoutMs) {
+        if (HasPending())
+            return true;
+
+        header_->waiters.fetch_add(1);
+        uint32_t expected = header_->futexWord.load();
+        if (!HasPending()) {
+            timespec timeout;
+            timeout.tv_sec = timeoutMs / 1000;
+            timeout.tv_nsec = (timeoutMs % 1000) * 1000000L;
+            Futex(&header_->futexWord, FUTEX_WAIT, expected, &timeout);
+        }
+        header_->waiters.fetch_sub(1);
+
+        return HasPending();
+    }
+
+    bool HasPending() const {
+        return readIndex_ < header_->writeIndex.load(std::memory_order_acquire);
+    }
+
+    uint64_t Dropped() const { return dropped_; }
+
+  private:
+    RingHeader *header_ = nullptr;
+    Slot *slots_ = nullptr;
+    size_t size_ = 0;
+    uint64_t readIndex_ = 0;
+    uint64_t dropped_ = 0;
+
+    bool tryRead(uint64_t index, cemuhook_protocol::DataEvent &out) const {
+        Slot const &slot = slots_[index % header_->slotCount];
+        uint64_t expected = 2 * index + 2;
+
+        if (slot.seq.load(std::memory_order_acquire) != expected)
+            return false;
+        std::memcpy(&out, &slot.event, sizeof(out));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return slot.seq.load(std::memory_order_relaxed) == expected;
+    }
+};
+
+#endif
+
+} // namespace cemushake_shm
@@ -0,0 +1,186 @@
+// Runs the server under simulated load and fails if anything allocates once it is warmed up.
+// Input comes from a ScriptedInputSource and a loopback client subscribes and keeps
+// sending requests, so the input, send and receive loops are all exercised.
+#include "../cemuhookserver.h"
+#include "../logger.h"
+#include "../scriptedinputsource.h"
+#include "testclient.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <thread>
+
+#define TEST_PORT 26799
+#define SUBSCRIBE_TIMEOUT_MS 10000
+#define WARMUP_MS 1500
+#define MEASURE_MS 3000
+#define REQUEST_INTERVAL_MS 250
+
+using namespace std::chrono;
+
+namespace {
+
+std::atomic<bool> armed{false};
+std::atomic<uint64_t> allocations{0};
+
+void *countedAlloc(size_t size) {
+    if (armed.load(std::memory_order_relaxed))
+        allocations.fetch_add(1, std::memory_order_relaxed);
+    void *ptr = std::malloc(size != 0 ? size : 1);
+    if (ptr == nullptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+const char *scriptPath = "build/alloc_steady_state.script";
+
+// RB pressed for 50 ms every 100 ms while the right stick sweeps, looped
+const char *script = "0 button 10 1\n"
+                     "0 axis 2 32767\n"
+                     "50 button 10 0\n"
+                     "50 axis 2 -20000\n"
+                     "100 button 10 0\n";
+
+// Sends subscribe, info and version requests in turn and drains every data packet received
+uint64_t runClient(int socketFd, sockaddr_in const &server, milliseconds duration) {
+    unsigned char subscribe[64], info[64], version[64], buf[256];
+    SubscribeRequest subscribeReq = {1, 0, 0, 0};
+    unsigned char infoReq[6] = {2, 0, 0, 0, 0, 1}; // portCnt 2, slots 0 and 1
+    size_t subscribeLen = buildRequest(subscribe, DATA_TYPE, &subscribeReq, sizeof(subscribeReq));
+    size_t infoLen = buildRequest(info, INFO_TYPE, infoReq, sizeof(infoReq));
+    size_t versionLen = buildRequest(version, VERSION_TYPE, nullptr, 0);
+
+    unsigned char const *requests[] = {subscribe, info, version};
+    size_t const lengths[] = {subscribeLen, infoLen, versionLen};
+
+    uint64_t received = 0;
+    int next = 0;
+    steady_clock::time_point end = steady_clock::now() + duration;
+    steady_clock::time_point nextRequest = steady_clock::now();
+
+    while (steady_clock::now() < end) {
+        if (steady_clock::now() >= nextRequest) {
+            crossSockets::SendPacket(socketFd, std::pair<uint16_t, void const *>(lengths[next], requests[next]), server);
+            next = (next + 1) % 3;
+            nextRequest += milliseconds(REQUEST_INTERVAL_MS);
+        }
+
+        while (recvfrom(socketFd, (char *)buf, sizeof(buf), 0, nullptr, nullptr) > 0) {
+            if (std::memcmp(buf, "DSUS", 4) == 0 && reinterpret_cast<Header *>(buf)->eventType == DATA_TYPE)
+                received++;
+        }
+        std::this_thread::sleep_for(milliseconds(1));
+    }
+    return received;
+}
+
+} // namespace
+
+void *operator new(size_t size) {
+    return countedAlloc(size);
+}
+
+void *operator new[](size_t size) {
+    return countedAlloc(size);
+}
+
+void *operator new(size_t size, std::nothrow_t const &) noexcept {
+    try {
+        return countedAlloc(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void *operator new[](size_t size, std::nothrow_t const &) noexcept {
+    try {
+        return countedAlloc(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void operator delete(void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+int main() {
+    logger::Start();
+
+    FILE *file = std::fopen(scriptPath, "w");
+    if (file == nullptr) {
+        std::printf("FAIL: could not write %s\n", scriptPath);
+        return 1;
+    }
+    std::fputs(script, file);
+    std::fclose(file);
+
+    Config cfg;
+    cfg.port = TEST_PORT;
+    cfg.gyro_compensation = true;
+    cfg.latency_trace = true;
+    cfg.sample_timestamps = true;
+    cfg.send_interval_us = 1000;
+    cfg.poll_interval_us = 1000;
+    cfg.buttons.emplace_back(SDL_CONTROLLER_BUTTON_RIGHTSHOULDER, 0.0f, 200.0f, 0.0f, 30.0f, 0.0f, 10.0f);
+    cfg.axes.push_back({SDL_CONTROLLER_AXIS_RIGHTX, AXIS_YAW, 0.1F, 1.5F, 300.0F});
+
+    crossSockets::initializeSockets();
+    int clientFd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    crossSockets::setSocketToNonBlocking(clientFd);
+    sockaddr_in server = sockaddr_in();
+    server.sin_family = AF_INET;
+    server.sin_port = htons(TEST_PORT);
+    server.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    Gamepad gamepad(std::move(cfg.buttons), std::unique_ptr<InputSource>(new ScriptedInputSource(scriptPath, true)), cfg.poll_interval_us);
+    Server serverUnderTest(&cfg, &gamepad);
+    gamepad.Start();
+    serverUnderTest.Start();
+
+    // Warm-up: wait until the client is subscribed and receiving, then let everything settle
+    uint64_t warmupPackets = 0;
+    steady_clock::time_point subscribeDeadline = steady_clock::now() + milliseconds(SUBSCRIBE_TIMEOUT_MS);
+    while (warmupPackets == 0 && steady_clock::now() < subscribeDeadline)
+        warmupPackets += runClient(clientFd, server, milliseconds(REQUEST_INTERVAL_MS));
+    warmupPackets += runClient(clientFd, server, milliseconds(WARMUP_MS));
+
+    armed = true;
+    uint64_t measuredPackets = runClient(clientFd, server, milliseconds(MEASURE_MS));
+    armed = false;
+
+    serverUnderTest.Stop();
+    gamepad.Stop();
+    logger::Stop();
+
+    std::printf("Packets received: %llu during warm-up, %llu measured\n",
+                static_cast<unsigned long long>(warmupPackets), static_cast<unsigned long long>(measuredPackets));
+    std::printf("Allocations after warm-up: %llu\n", static_cast<unsigned long long>(allocations.load()));
+
+    if (measuredPackets == 0) {
+        std::printf("FAIL: the client never received data\n");
+        return 1;
+    }
+    if (allocations.load() != 0) {
+        std::printf("FAIL: the steady state allocated\n");
+        return 1;
+    }
+    std::printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,133 @@
+// Checks that gyro compensation undoes button motion but never analog aiming.
+// The right stick aims (yaw) while a button adds pitch for 100 ms. Once the button is released
+// its pitch must be replayed in reverse even though the stick is still held, and the yaw must
+// never be sent back negated when the stick is released.
+#include "../cemuhookserver.h"
+#include "../logger.h"
+#include "../scriptedinputsource.h"
+#include "testclient.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+#define TEST_PORT 26798
+#define BUTTON_PITCH 30.0F
+#define SUBSCRIBE_BY_MS 900 // The script stays idle until 1000 ms so the client is receiving by then
+#define RUN_MS 2500
+#define REQUEST_INTERVAL_MS 250
+
+using namespace std::chrono;
+
+namespace {
+
+const char *scriptPath = "build/gyro_compensation.script";
+
+const char *script = "1000 axis 2 32767\n"
+                     "1100 button 10 1\n"
+                     "1200 button 10 0\n"
+                     "1500 axis 2 0\n"
+                     "1600 button 10 0\n";
+
+} // namespace
+
+int main() {
+    logger::Start();
+
+    FILE *file = std::fopen(scriptPath, "w");
+    if (file == nullptr) {
+        std::printf("FAIL: could not write %s\n", scriptPath);
+        return 1;
+    }
+    std::fputs(script, file);
+    std::fclose(file);
+
+    Config cfg;
+    cfg.port = TEST_PORT;
+    cfg.gyro_compensation = true;
+    cfg.send_interval_us = 1000;
+    cfg.poll_interval_us = 1000;
+    cfg.buttons.emplace_back(SDL_CONTROLLER_BUTTON_RIGHTSHOULDER, 0.0f, 0.0f, 0.0f, BUTTON_PITCH, 0.0f, 0.0f);
+    cfg.axes.push_back({SDL_CONTROLLER_AXIS_RIGHTX, AXIS_YAW, 0.1F, 1.0F, 300.0F});
+
+    crossSockets::initializeSockets();
+    int clientFd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    crossSockets::setSocketToNonBlocking(clientFd);
+    sockaddr_in server = sockaddr_in();
+    server.sin_family = AF_INET;
+    server.sin_port = htons(TEST_PORT);
+    server.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    // The script clock starts when the gamepad connects to it, in the constructor
+    steady_clock::time_point scriptStart = steady_clock::now();
+    Gamepad gamepad(std::move(cfg.buttons), std::unique_ptr<InputSource>(new ScriptedInputSource(scriptPath, false)), cfg.poll_interval_us);
+    Server serverUnderTest(&cfg, &gamepad);
+    gamepad.Start();
+    serverUnderTest.Start();
+
+    unsigned char subscribe[64], buf[256];
+    SubscribeRequest subscribeReq = {1, 0, 0, 0};
+    size_t subscribeLen = buildRequest(subscribe, DATA_TYPE, &subscribeReq, sizeof(subscribeReq));
+
+    uint64_t received = 0;
+    steady_clock::time_point firstPacket;
+    bool yawSeen = false;
+    bool yawReversed = false;
+    bool pitchSeen = false;
+    bool pitchCompensatedWhileAiming = false;
+    double pitchTotal = 0.0;
+
+    steady_clock::time_point end = scriptStart + milliseconds(RUN_MS);
+    steady_clock::time_point nextRequest = steady_clock::now();
+    while (steady_clock::now() < end) {
+        if (steady_clock::now() >= nextRequest) {
+            crossSockets::SendPacket(clientFd, std::pair<uint16_t, void const *>(subscribeLen, subscribe), server);
+            nextRequest += milliseconds(REQUEST_INTERVAL_MS);
+        }
+
+        while (recvfrom(clientFd, (char *)buf, sizeof(buf), 0, nullptr, nullptr) == sizeof(DataEvent)) {
+            DataEvent const *event = reinterpret_cast<DataEvent const *>(buf);
+            if (std::memcmp(buf, "DSUS", 4) != 0 || event->header.eventType != DATA_TYPE)
+                continue;
+
+            if (received++ == 0)
+                firstPacket = steady_clock::now();
+
+            float yaw = event->motion.yaw;
+            float pitch = event->motion.pitch;
+            yawSeen |= yaw > 0.0F;
+            yawReversed |= yaw < 0.0F;
+            pitchSeen |= pitch > 0.0F;
+            pitchCompensatedWhileAiming |= pitch < 0.0F && yaw > 0.0F;
+            pitchTotal += pitch;
+        }
+        std::this_thread::sleep_for(milliseconds(1));
+    }
+
+    serverUnderTest.Stop();
+    gamepad.Stop();
+    logger::Stop();
+
+    std::printf("Packets received: %llu, pitch left after compensation: %.1f\n", static_cast<unsigned long long>(received), pitchTotal);
+
+    if (received == 0 || firstPacket - scriptStart > milliseconds(SUBSCRIBE_BY_MS)) {
+        std::printf("FAIL: the client was not receiving data before the script started\n");
+        return 1;
+    }
+    if (!yawSeen || !pitchSeen) {
+        std::printf("FAIL: the scripted stick or button never reached the client\n");
+        return 1;
+    }
+    if (yawReversed) {
+        std::printf("FAIL: analog aiming was reversed by gyro compensation\n");
+        return 1;
+    }
+    if (!pitchCompensatedWhileAiming || std::fabs(pitchTotal) > BUTTON_PITCH) {
+        std::printf("FAIL: the button motion was not compensated while the stick was held\n");
+        return 1;
+    }
+    std::printf("PASS\n");
+    return 0;
+}
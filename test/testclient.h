@@ -0,0 +1,30 @@
+#pragma once
+// Helpers shared by the tests to talk to a Server over loopback like a cemuhook client would.
+#include "../cemuhookprotocol.h"
+#include "../crc32.h"
+#include "../requestparser.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+using namespace cemuhook_protocol;
+
+// Writes a complete client request (header, payload and CRC) into buf and returns its length
+inline size_t buildRequest(unsigned char *buf, uint32_t eventType, const void *payload, uint16_t payloadLen) {
+    Header header;
+    std::memcpy(header.magic, "DSUC", 4);
+    header.version = PROTOCOL_VERSION;
+    header.length = payloadLen + 4;
+    header.crc32 = 0;
+    header.id = 1234;
+    header.eventType = eventType;
+
+    std::memcpy(buf, &header, sizeof(header));
+    std::memcpy(buf + sizeof(header), payload, payloadLen);
+    size_t len = sizeof(header) + payloadLen;
+
+    uint32_t crc = crc32(buf, len);
+    std::memcpy(buf + offsetof(Header, crc32), &crc, sizeof(crc));
+    return len;
+}